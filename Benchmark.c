@@ -0,0 +1,272 @@
+/**
+ * Program to time the replacement policies on synthetic workloads. Every
+ * (workload, policy, frame count) run reports its faults, references per
+ * second and nanoseconds per access as CSV or JSON, so changes to the page
+ * table hot path can be compared with numbers.
+ *
+ * Usage: pra_bench [--format csv|json] [--workloads uniform,zipf,...|all]
+ *                  [--policies FIFO,LRU,...|all] [--frames 256,4096,...]
+ *                  [--pages N] [--length N] [--repeat N] [--seed N]
+ *                  [--backend dense|sparse] [--generate <trace>]
+ *
+ * @author Lee
+ * @version 1.0
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "DataLoader.h"
+#include "PageTable.h"
+#include "Workload.h"
+
+//most entries in a comma separated option
+#define MAX_LIST 32
+
+//what to run
+struct bench_options {
+    int csv;
+    enum workload_kind workloads[WORKLOAD_KIND_COUNT];
+    int workload_count;
+    enum replacement_algorithm policies[MAX_LIST];
+    int policy_count;
+    int frames[MAX_LIST];
+    int frame_count;
+    int page_count;
+    long long length;
+    int repeat;
+    unsigned long long seed;
+    enum page_table_backend backend;
+    char *generate;
+};
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+}
+
+/**
+ * Parses a comma separated list of policy names.
+ * @return 0 on success, -1 for an unknown name
+ */
+static int parse_policies(char *list, struct bench_options *options) {
+    options->policy_count = 0;
+    if (strcmp(list, "all") == 0) {
+        for (int i = 0; i <= WSCLOCK; i++) {
+            options->policies[options->policy_count++] = (enum replacement_algorithm) i;
+        }
+        return 0;
+    }
+    for (char *name = strtok(list, ","); name && options->policy_count < MAX_LIST; name = strtok(NULL, ",")) {
+        if (page_table_algorithm_from_name(name, &(options->policies[options->policy_count])) != 0) {
+            printf("Unknown policy %s\n", name);
+            return -1;
+        }
+        options->policy_count++;
+    }
+    return 0;
+}
+
+/**
+ * Parses a comma separated list of workload names.
+ * @return 0 on success, -1 for an unknown name
+ */
+static int parse_workloads(char *list, struct bench_options *options) {
+    options->workload_count = 0;
+    if (strcmp(list, "all") == 0) {
+        for (int i = 0; i < WORKLOAD_KIND_COUNT; i++) {
+            options->workloads[options->workload_count++] = (enum workload_kind) i;
+        }
+        return 0;
+    }
+    for (char *name = strtok(list, ","); name && options->workload_count < WORKLOAD_KIND_COUNT;
+         name = strtok(NULL, ",")) {
+        if (workload_from_name(name, &(options->workloads[options->workload_count])) != 0) {
+            printf("Unknown workload %s\n", name);
+            return -1;
+        }
+        options->workload_count++;
+    }
+    return 0;
+}
+
+/**
+ * Parses a comma separated list of frame counts.
+ * @return 0 on success, -1 for a count below 1
+ */
+static int parse_frames(char *list, struct bench_options *options) {
+    options->frame_count = 0;
+    for (char *count = strtok(list, ","); count && options->frame_count < MAX_LIST; count = strtok(NULL, ",")) {
+        options->frames[options->frame_count] = atoi(count);
+        if (options->frames[options->frame_count] < 1) {
+            printf("Invalid frame count %s\n", count);
+            return -1;
+        }
+        options->frame_count++;
+    }
+    return 0;
+}
+
+/**
+ * Parses the command line over the defaults: every workload and policy on
+ * 2^20 references to 65536 pages, with 256 and 4096 frames on the dense
+ * backend, best of 3.
+ * @return 0 on success, -1 on a bad option
+ */
+static int parse_options(int argc, char *argv[], struct bench_options *options) {
+    options->csv = 1;
+    parse_workloads("all", options);
+    parse_policies("all", options);
+    options->frames[0] = 256;
+    options->frames[1] = 4096;
+    options->frame_count = 2;
+    options->page_count = 65536;
+    options->length = 1 << 20;
+    options->repeat = 3;
+    options->seed = 1;
+    options->backend = DENSE_TABLE;
+    options->generate = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc) {
+            printf("Missing value for %s\n", argv[i]);
+            return -1;
+        }
+        char *value = argv[++i];
+        int status = 0;
+        if (strcmp(argv[i - 1], "--format") == 0) {
+            options->csv = strcmp(value, "json") != 0;
+            status = options->csv && strcmp(value, "csv") != 0 ? -1 : 0;
+        } else if (strcmp(argv[i - 1], "--workloads") == 0) {
+            status = parse_workloads(value, options);
+        } else if (strcmp(argv[i - 1], "--policies") == 0) {
+            status = parse_policies(value, options);
+        } else if (strcmp(argv[i - 1], "--frames") == 0) {
+            status = parse_frames(value, options);
+        } else if (strcmp(argv[i - 1], "--pages") == 0) {
+            options->page_count = atoi(value);
+        } else if (strcmp(argv[i - 1], "--length") == 0) {
+            options->length = atoll(value);
+        } else if (strcmp(argv[i - 1], "--repeat") == 0) {
+            options->repeat = atoi(value) > 0 ? atoi(value) : 1;
+        } else if (strcmp(argv[i - 1], "--seed") == 0) {
+            options->seed = strtoull(value, NULL, 10);
+        } else if (strcmp(argv[i - 1], "--backend") == 0) {
+            options->backend = strcmp(value, "sparse") == 0 ? SPARSE_TABLE : DENSE_TABLE;
+            status = options->backend == DENSE_TABLE && strcmp(value, "dense") != 0 ? -1 : 0;
+        } else if (strcmp(argv[i - 1], "--generate") == 0) {
+            options->generate = value;
+        } else {
+            status = -1;
+        }
+        if (status != 0) {
+            printf("Bad option %s %s\n", argv[i - 1], value);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Replays a reference string through one table repeat times, resetting it in
+ * between, and keeps the fastest run. Creating and resetting the table is not
+ * timed; OPT's flush is.
+ * @param seconds receives the fastest time
+ * @return the number of faults, -1 if the table could not be created
+ */
+static long long time_policy(const int *pages, long long length, int page_count, int frame_count,
+                             enum replacement_algorithm policy, enum page_table_backend backend, int repeat,
+                             double *seconds) {
+    struct page_table_config config;
+    page_table_config_init(&config, page_count, frame_count, policy);
+    config.backend = backend;
+    struct page_table *pt = page_table_create_config(&config);
+    if (!pt) {
+        return -1;
+    }
+    long long faults = -1;
+    *seconds = 0;
+    for (int r = 0; r < repeat; r++) {
+        if (r > 0) {
+            page_table_reset(pt);
+        }
+        double start = now_seconds();
+        for (long long i = 0; i < length; i += TRACE_CHUNK_SIZE) {
+            long long n = length - i < TRACE_CHUNK_SIZE ? length - i : TRACE_CHUNK_SIZE;
+            page_table_access_pages(pt, pages + i, (size_t) n);
+        }
+        page_table_flush(pt);
+        double elapsed = now_seconds() - start;
+        if (r == 0 || elapsed < *seconds) {
+            *seconds = elapsed;
+        }
+        faults = page_table_get_faults(pt);
+    }
+    page_table_destroy(&pt);
+    return faults;
+}
+
+int main(int argc, char* argv[]) {
+    struct bench_options options;
+    if (parse_options(argc, argv, &options) != 0) {
+        printf("Usage: %s [--format csv|json] [--workloads uniform,zipf,scan,loop,phase,stride|all]\n"
+               "       [--policies FIFO,LRU,...|all] [--frames 256,4096,...] [--pages N] [--length N]\n"
+               "       [--repeat N] [--seed N] [--backend dense|sparse] [--generate <trace>]\n", argv[0]);
+        return 1;
+    }
+
+    if (options.generate) {
+        // write the first workload as a text trace instead of timing
+        struct workload_config config;
+        workload_config_init(&config, options.workloads[0], options.page_count, options.length);
+        config.seed = options.seed;
+        return workload_write_trace(&config, options.frames[0], options.generate) == 0 ? 0 : 1;
+    }
+
+    if (options.csv) {
+        printf("workload,policy,frames,references,faults,seconds,refs_per_sec,ns_per_access\n");
+    } else {
+        printf("[\n");
+    }
+    int first = 1;
+    for (int w = 0; w < options.workload_count; w++) {
+        struct workload_config config;
+        workload_config_init(&config, options.workloads[w], options.page_count, options.length);
+        config.seed = options.seed;
+        int *pages = workload_generate(&config);
+        if (!pages) {
+            return 1;
+        }
+        for (int f = 0; f < options.frame_count; f++) {
+            for (int p = 0; p < options.policy_count; p++) {
+                double seconds;
+                long long faults = time_policy(pages, options.length, options.page_count, options.frames[f],
+                                               options.policies[p], options.backend, options.repeat, &seconds);
+                if (faults < 0) {
+                    continue;
+                }
+                double rate = seconds > 0 ? (double) options.length / seconds : 0;
+                double ns = options.length > 0 ? seconds * 1e9 / (double) options.length : 0;
+                const char *workload = workload_name(options.workloads[w]);
+                const char *policy = page_table_algorithm_name(options.policies[p]);
+                if (options.csv) {
+                    printf("%s,%s,%d,%lld,%lld,%.6f,%.0f,%.2f\n", workload, policy, options.frames[f],
+                           options.length, faults, seconds, rate, ns);
+                } else {
+                    printf("%s  {\"workload\": \"%s\", \"policy\": \"%s\", \"frames\": %d, \"references\": %lld, "
+                           "\"faults\": %lld, \"seconds\": %.6f, \"refs_per_sec\": %.0f, \"ns_per_access\": %.2f}",
+                           first ? "" : ",\n", workload, policy, options.frames[f], options.length, faults,
+                           seconds, rate, ns);
+                }
+                first = 0;
+                fflush(stdout);
+            }
+        }
+        free(pages);
+    }
+    if (!options.csv) {
+        printf("\n]\n");
+    }
+    return 0;
+}
@@ -0,0 +1,62 @@
+/**
+ * Vectorized searches over arrays of saturating uint32 counters, used by the
+ * counter-based replacement policies to pick a victim frame. The fastest
+ * kernel the CPU supports is chosen at run time.
+ *
+ * @author Lee
+ * @version 1.0
+ */
+
+#ifndef COUNTERSCAN_H
+#define COUNTERSCAN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Adds one to a counter, sticking at UINT32_MAX instead of wrapping.
+ *
+ * @param counter The counter to increment.
+ */
+static inline void counter_increment(uint32_t *counter) {
+    *counter += *counter != UINT32_MAX;
+}
+
+/**
+ * Returns the index of the smallest counter. Ties go to the lowest index.
+ *
+ * @param counters The counters to search.
+ * @param n Number of counters, at least 1.
+ * @return Index of the smallest counter.
+ */
+size_t counter_argmin(const uint32_t *counters, size_t n);
+
+/**
+ * Returns the index of the largest counter. Ties go to the lowest index.
+ *
+ * @param counters The counters to search.
+ * @param n Number of counters, at least 1.
+ * @return Index of the largest counter.
+ */
+size_t counter_argmax(const uint32_t *counters, size_t n);
+
+/**
+ * Ages shift-register counters by one tick: every counter shifts right and
+ * takes its referenced flag as the new top bit, then the flags are cleared.
+ *
+ * @param counters The counters to age.
+ * @param referenced Per-counter referenced flags, 0 or 1.
+ * @param n Number of counters.
+ * @param bits Width of the counters, from 1 to 32.
+ */
+void counter_age(uint32_t *counters, uint32_t *referenced, size_t n, int bits);
+
+/**
+ * Returns the name of the kernel counter_argmin and counter_argmax use on
+ * this CPU.
+ *
+ * @return "avx2", "neon" or "scalar".
+ */
+const char *counter_scan_kernel(void);
+
+#endif
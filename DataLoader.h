@@ -11,21 +11,190 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+//number of references handed out by a trace_reader per chunk
+#define TRACE_CHUNK_SIZE 4096
+
 //structs
 struct test_scenario {
     int refstr_len;
-    int refstr[512];
+    int *refstr;
+    int page_count;
+    int frame_count;
+};
+
+//header of a trace file
+struct trace_header {
     int page_count;
     int frame_count;
+    long long length;
+    // nonzero if references carry a pid; text traces set it once a pid:page
+    // reference has been read
+    int has_pids;
+    // nonzero if references carry read/write flags; text traces set it once a
+    // write has been read
+    int has_writes;
+};
+
+//how a binary trace stores its references
+enum trace_encoding {
+    // fixed-width little-endian page numbers
+    PACKED_ENCODING = 0,
+    // blocks of Stream-VByte zigzag deltas, one to four bytes per reference
+    DELTA_ENCODING
 };
 
+//where a trace_reader is in its trace
+struct trace_mark {
+    // references handed out so far
+    long long position;
+    // byte offset in the uncompressed trace where reading resumes, after
+    // skipping skip references of the delta block starting there
+    long long offset;
+    int skip;
+};
+
+//forward declarations for structs
+struct trace_reader;
 
 /**
- * Loads a test_scenario strut from a textfile.
+ * Loads a test_scenario strut from a textfile. The whole reference string is
+ * kept in memory; use a trace_reader for long traces.
  *
  * @param filename The name of the file to load.
  * @return A struct containing the loaded file.
  */
 struct test_scenario* load_test_data(char* filename);
 
-#endif
\ No newline at end of file
+/**
+ * Destroys a test_scenario loaded by load_test_data. Sets outside variable to
+ * NULL.
+ *
+ * @param ts A test_scenario object.
+ */
+void test_data_destroy(struct test_scenario** ts);
+
+/**
+ * Opens a trace file for streaming. Only the header is read up front; the
+ * reference string is handed out in chunks by trace_reader_next_chunk, so
+ * memory use does not depend on the length of the trace.
+ *
+ * Both the text format (page count, frame count and length followed by the
+ * references, whitespace separated) and the binary format written by
+ * trace_convert_to_binary are accepted; binary traces are memory-mapped.
+ * Multi-process traces write every reference as pid:page, and a reference
+ * ending in w (12w, 3:12w) is a write. Text traces may be zstd or LZ4
+ * compressed when the build has the codec; a producer thread then
+ * decompresses ahead of the reader.
+ *
+ * @param filename The name of the file to open.
+ * @return A trace_reader object, or NULL if the file could not be opened.
+ */
+struct trace_reader* trace_reader_open(char* filename);
+
+/**
+ * Closes a trace_reader. Sets outside variable to NULL.
+ *
+ * @param reader A trace_reader object.
+ */
+void trace_reader_close(struct trace_reader** reader);
+
+/**
+ * Returns the header of the trace being read.
+ *
+ * @param reader A trace_reader object.
+ * @return The header of the trace.
+ */
+const struct trace_header* trace_reader_header(const struct trace_reader* reader);
+
+/**
+ * Returns the name of the format of the trace being read: "text", "zstd" or
+ * "lz4" for text traces, "packed" or "delta" for binary traces.
+ *
+ * @param reader A trace_reader object.
+ * @return The name of the format.
+ */
+const char* trace_reader_format_name(const struct trace_reader* reader);
+
+/**
+ * Reads the next chunk of references from a trace.
+ *
+ * @param reader A trace_reader object.
+ * @param pages Buffer receiving the references.
+ * @param max_pages Capacity of pages; TRACE_CHUNK_SIZE is a good choice.
+ * @return Number of references read, 0 at the end of the trace, -1 on error.
+ */
+int trace_reader_next_chunk(struct trace_reader* reader, int* pages, int max_pages);
+
+/**
+ * Reads the next chunk of references from a trace together with the pid of
+ * every reference. References without a pid belong to pid 0.
+ *
+ * @param reader A trace_reader object.
+ * @param pids Buffer receiving the pids, or NULL.
+ * @param pages Buffer receiving the references.
+ * @param max_pages Capacity of pids and pages.
+ * @return Number of references read, 0 at the end of the trace, -1 on error.
+ */
+int trace_reader_next_chunk_pids(struct trace_reader* reader, int* pids, int* pages, int max_pages);
+
+/**
+ * Reads the next chunk of references from a trace together with whether
+ * every reference is a write. Traces without write flags only hold reads.
+ *
+ * @param reader A trace_reader object.
+ * @param pages Buffer receiving the references.
+ * @param writes Buffer receiving 1 for a write and 0 for a read.
+ * @param max_pages Capacity of pages and writes.
+ * @return Number of references read, 0 at the end of the trace, -1 on error.
+ */
+int trace_reader_next_chunk_writes(struct trace_reader* reader, int* pages, unsigned char* writes, int max_pages);
+
+/**
+ * Restarts reading at the first reference of the trace.
+ *
+ * @param reader A trace_reader object.
+ * @return 0 on success, -1 on error.
+ */
+int trace_reader_rewind(struct trace_reader* reader);
+
+/**
+ * Records where a reader is in its trace, to resume there later with
+ * trace_reader_seek, possibly from another reader of the same trace.
+ *
+ * @param reader A trace_reader object.
+ * @param mark Receives the position.
+ */
+void trace_reader_tell(const struct trace_reader* reader, struct trace_mark* mark);
+
+/**
+ * Continues reading where trace_reader_tell left off. Uncompressed text and
+ * binary traces seek straight to the byte offset; compressed text traces are
+ * decompressed again up to it.
+ *
+ * @param reader A trace_reader object.
+ * @param mark A position recorded on the same trace.
+ * @return 0 on success, -1 if the mark does not fit the trace or on error.
+ */
+int trace_reader_seek(struct trace_reader* reader, const struct trace_mark* mark);
+
+/**
+ * Converts a text trace into the binary trace format: a 32-byte little-endian
+ * header ("PRAT", version, reference width, flags, page count, frame count,
+ * encoding, 64-bit length) followed by the references.
+ *
+ * Packed traces store 16-bit page numbers when page_count allows it, 32-bit
+ * otherwise. Delta-encoded traces store blocks of up to TRACE_CHUNK_SIZE
+ * references as Stream-VByte zigzag deltas, so local references take one
+ * byte each. Multi-process traces set flag bit 0 and carry a 32-bit pid
+ * before each page, or a delta-encoded pid stream in each block. Traces with
+ * writes set flag bit 1 and store every page as page * 2 + 1 for a write,
+ * page * 2 for a read.
+ *
+ * @param text_filename The text trace to convert.
+ * @param binary_filename The binary trace to write.
+ * @param encoding How references are stored.
+ * @return 0 on success, -1 on error.
+ */
+int trace_convert_to_binary(char* text_filename, char* binary_filename, enum trace_encoding encoding);
+
+#endif
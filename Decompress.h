@@ -0,0 +1,88 @@
+/**
+ * Decompression pipeline for compressed traces. A producer thread inflates a
+ * zstd or LZ4 frame stream into a small ring of buffers while the reader
+ * consumes them, so decompression overlaps with simulation.
+ *
+ * Codecs are optional: builds without PRA_HAVE_ZSTD or PRA_HAVE_LZ4 still
+ * recognize the format and report that it is not supported.
+ *
+ * @author Lee
+ * @version 1.0
+ */
+
+#ifndef DECOMPRESS_H
+#define DECOMPRESS_H
+
+#include <stdio.h>
+
+//number of buffers in the ring between the producer and the reader
+#define DECOMPRESS_SLOTS 4
+//size of a buffer in the ring
+#define DECOMPRESS_SLOT_SIZE (1 << 18)
+
+//compression formats, recognized by the frame magic
+enum compression {
+    NO_COMPRESSION = 0,
+    ZSTD_COMPRESSION,
+    LZ4_COMPRESSION
+};
+
+//forward declarations for structs
+struct decompress_stream;
+
+/**
+ * Recognizes a compressed file from its first bytes.
+ *
+ * @param magic The first bytes of the file.
+ * @param len Number of bytes in magic.
+ * @return The compression format, NO_COMPRESSION if none is recognized.
+ */
+enum compression decompress_detect(const unsigned char* magic, size_t len);
+
+/**
+ * Returns the name of a compression format.
+ *
+ * @param codec A compression format.
+ * @return The name of the format.
+ */
+const char* decompress_name(enum compression codec);
+
+/**
+ * Starts decompressing a file. The stream takes ownership of fp, which is
+ * read from the beginning.
+ *
+ * @param fp The compressed file.
+ * @param codec The compression format of the file.
+ * @return A decompress_stream object, or NULL if the codec was not built in.
+ */
+struct decompress_stream* decompress_stream_open(FILE* fp, enum compression codec);
+
+/**
+ * Stops the producer thread and closes the file. Sets outside variable to
+ * NULL.
+ *
+ * @param ds A decompress_stream object.
+ */
+void decompress_stream_close(struct decompress_stream** ds);
+
+/**
+ * Hands out the next buffer of decompressed bytes. The buffer stays valid
+ * until the next call, after which the producer may reuse it.
+ *
+ * @param ds A decompress_stream object.
+ * @param data Receives the decompressed bytes.
+ * @param len Receives the number of bytes in data.
+ * @return 1 if a buffer was handed out, 0 at the end of the stream, -1 on a
+ * corrupt or truncated stream.
+ */
+int decompress_stream_next(struct decompress_stream* ds, const unsigned char** data, size_t* len);
+
+/**
+ * Restarts decompression at the beginning of the file.
+ *
+ * @param ds A decompress_stream object.
+ * @return 0 on success, -1 on error.
+ */
+int decompress_stream_rewind(struct decompress_stream* ds);
+
+#endif
@@ -0,0 +1,86 @@
+/**
+ * Open-addressing hash map from non-negative int keys to int values.
+ *
+ * @author Lee
+ * @version 1.0
+ */
+
+#ifndef INTMAP_H
+#define INTMAP_H
+
+#include <stdlib.h>
+
+//structs
+struct int_map {
+    // keys[i] is INT_MAP_FREE for unused slots
+    int *keys;
+    int *values;
+    // capacity is always a power of two, 1 << (32 - shift)
+    unsigned capacity;
+    unsigned shift;
+    unsigned size;
+};
+
+//marks an unused slot; keys must be non-negative
+#define INT_MAP_FREE (-1)
+
+/**
+ * Initializes an empty map sized for the expected number of keys.
+ *
+ * @param map The map to initialize.
+ * @param expected Expected number of keys; the map grows past it as needed.
+ */
+void int_map_init(struct int_map* map, unsigned expected);
+
+/**
+ * Frees the storage of a map.
+ *
+ * @param map The map to free.
+ */
+void int_map_free(struct int_map* map);
+
+/**
+ * Removes all keys, keeping the storage.
+ *
+ * @param map The map to clear.
+ */
+void int_map_clear(struct int_map* map);
+
+/**
+ * Returns the value stored for a key.
+ *
+ * @param map The map to search.
+ * @param key The key to look up.
+ * @param missing Value returned when the key is not present.
+ * @return The value of the key, or missing.
+ */
+int int_map_get(const struct int_map* map, int key, int missing);
+
+/**
+ * Stores a value for a key, replacing any previous value.
+ *
+ * @param map The map to update.
+ * @param key The key to store.
+ * @param value The value to store.
+ */
+void int_map_put(struct int_map* map, int key, int value);
+
+/**
+ * Removes a key. Removal shifts later entries of the probe sequence back, so
+ * the map never accumulates tombstones.
+ *
+ * @param map The map to update.
+ * @param key The key to remove.
+ * @return 1 if the key was present, 0 otherwise.
+ */
+int int_map_remove(struct int_map* map, int key);
+
+/**
+ * Copies all keys into an array.
+ *
+ * @param map The map to read.
+ * @param keys Receives map->size keys, in no particular order.
+ */
+void int_map_keys(const struct int_map* map, int* keys);
+
+#endif
@@ -0,0 +1,288 @@
+/*
+ * Argmin/argmax over uint32 counters.
+ *
+ * Every kernel makes two passes: the first reduces the array to its extreme
+ * value with vector min/max, the second finds the first lane equal to it with
+ * a vector compare. Both passes are branch-free per element, which is what
+ * matters once frame counts reach the thousands. AVX2 handles 8 counters per
+ * step and is picked at run time on x86-64; NEON handles 4 and is always
+ * present on AArch64.
+ */
+
+#include "CounterScan.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define COUNTER_SCAN_AVX2 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define COUNTER_SCAN_NEON 1
+#endif
+
+static size_t find_first_scalar(const uint32_t *counters, size_t start, uint32_t value) {
+    size_t i = start;
+    while (counters[i] != value) {
+        i++;
+    }
+    return i;
+}
+
+static size_t argmin_scalar(const uint32_t *counters, size_t n) {
+    size_t best = 0;
+    for (size_t i = 1; i < n; i++) {
+        if (counters[i] < counters[best]) {
+            best = i;
+        }
+    }
+    return best;
+}
+
+static size_t argmax_scalar(const uint32_t *counters, size_t n) {
+    size_t best = 0;
+    for (size_t i = 1; i < n; i++) {
+        if (counters[i] > counters[best]) {
+            best = i;
+        }
+    }
+    return best;
+}
+
+static void age_scalar(uint32_t *counters, uint32_t *referenced, size_t start, size_t n, int bits) {
+    for (size_t i = start; i < n; i++) {
+        counters[i] = (counters[i] >> 1) | (referenced[i] << (bits - 1));
+        referenced[i] = 0;
+    }
+}
+
+#ifdef COUNTER_SCAN_AVX2
+
+/**
+ * Finds the first counter equal to value, 8 at a time. value must be present.
+ */
+__attribute__((target("avx2")))
+static size_t find_first_avx2(const uint32_t *counters, size_t n, uint32_t value) {
+    __m256i target = _mm256_set1_epi32((int) value);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i lanes = _mm256_loadu_si256((const __m256i *) (counters + i));
+        int mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(lanes, target)));
+        if (mask) {
+            return i + (size_t) __builtin_ctz((unsigned) mask);
+        }
+    }
+    return find_first_scalar(counters, i, value);
+}
+
+__attribute__((target("avx2")))
+static uint32_t reduce_avx2(__m256i v, int most) {
+    uint32_t lanes[8];
+    _mm256_storeu_si256((__m256i *) lanes, v);
+    uint32_t best = lanes[0];
+    for (int i = 1; i < 8; i++) {
+        if (most ? lanes[i] > best : lanes[i] < best) {
+            best = lanes[i];
+        }
+    }
+    return best;
+}
+
+__attribute__((target("avx2")))
+static size_t argmin_avx2(const uint32_t *counters, size_t n) {
+    if (n < 8) {
+        return argmin_scalar(counters, n);
+    }
+    __m256i low = _mm256_loadu_si256((const __m256i *) counters);
+    size_t i = 8;
+    for (; i + 8 <= n; i += 8) {
+        low = _mm256_min_epu32(low, _mm256_loadu_si256((const __m256i *) (counters + i)));
+    }
+    uint32_t value = reduce_avx2(low, 0);
+    for (; i < n; i++) {
+        if (counters[i] < value) {
+            value = counters[i];
+        }
+    }
+    return find_first_avx2(counters, n, value);
+}
+
+__attribute__((target("avx2")))
+static size_t argmax_avx2(const uint32_t *counters, size_t n) {
+    if (n < 8) {
+        return argmax_scalar(counters, n);
+    }
+    __m256i high = _mm256_loadu_si256((const __m256i *) counters);
+    size_t i = 8;
+    for (; i + 8 <= n; i += 8) {
+        high = _mm256_max_epu32(high, _mm256_loadu_si256((const __m256i *) (counters + i)));
+    }
+    uint32_t value = reduce_avx2(high, 1);
+    for (; i < n; i++) {
+        if (counters[i] > value) {
+            value = counters[i];
+        }
+    }
+    return find_first_avx2(counters, n, value);
+}
+
+__attribute__((target("avx2")))
+static void age_avx2(uint32_t *counters, uint32_t *referenced, size_t n, int bits) {
+    __m128i shift = _mm_cvtsi32_si128(bits - 1);
+    __m256i zero = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i c = _mm256_loadu_si256((const __m256i *) (counters + i));
+        __m256i r = _mm256_loadu_si256((const __m256i *) (referenced + i));
+        c = _mm256_or_si256(_mm256_srli_epi32(c, 1), _mm256_sll_epi32(r, shift));
+        _mm256_storeu_si256((__m256i *) (counters + i), c);
+        _mm256_storeu_si256((__m256i *) (referenced + i), zero);
+    }
+    age_scalar(counters, referenced, i, n, bits);
+}
+
+static int has_avx2(void) {
+    return __builtin_cpu_supports("avx2");
+}
+
+#endif
+
+#ifdef COUNTER_SCAN_NEON
+
+/**
+ * Finds the first counter equal to value, 4 at a time. value must be present.
+ */
+static size_t find_first_neon(const uint32_t *counters, size_t n, uint32_t value) {
+    uint32x4_t target = vdupq_n_u32(value);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        if (vmaxvq_u32(vceqq_u32(vld1q_u32(counters + i), target))) {
+            break;
+        }
+    }
+    return find_first_scalar(counters, i, value);
+}
+
+static size_t argmin_neon(const uint32_t *counters, size_t n) {
+    if (n < 4) {
+        return argmin_scalar(counters, n);
+    }
+    uint32x4_t low = vld1q_u32(counters);
+    size_t i = 4;
+    for (; i + 4 <= n; i += 4) {
+        low = vminq_u32(low, vld1q_u32(counters + i));
+    }
+    uint32_t value = vminvq_u32(low);
+    for (; i < n; i++) {
+        if (counters[i] < value) {
+            value = counters[i];
+        }
+    }
+    return find_first_neon(counters, n, value);
+}
+
+static size_t argmax_neon(const uint32_t *counters, size_t n) {
+    if (n < 4) {
+        return argmax_scalar(counters, n);
+    }
+    uint32x4_t high = vld1q_u32(counters);
+    size_t i = 4;
+    for (; i + 4 <= n; i += 4) {
+        high = vmaxq_u32(high, vld1q_u32(counters + i));
+    }
+    uint32_t value = vmaxvq_u32(high);
+    for (; i < n; i++) {
+        if (counters[i] > value) {
+            value = counters[i];
+        }
+    }
+    return find_first_neon(counters, n, value);
+}
+
+static void age_neon(uint32_t *counters, uint32_t *referenced, size_t n, int bits) {
+    int32x4_t shift = vdupq_n_s32(bits - 1);
+    uint32x4_t zero = vdupq_n_u32(0);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        uint32x4_t c = vld1q_u32(counters + i);
+        uint32x4_t r = vld1q_u32(referenced + i);
+        vst1q_u32(counters + i, vorrq_u32(vshrq_n_u32(c, 1), vshlq_u32(r, shift)));
+        vst1q_u32(referenced + i, zero);
+    }
+    age_scalar(counters, referenced, i, n, bits);
+}
+
+#endif
+
+/**
+ * Returns the index of the smallest counter. Ties go to the lowest index.
+ *
+ * @param counters The counters to search.
+ * @param n Number of counters, at least 1.
+ * @return Index of the smallest counter.
+ */
+size_t counter_argmin(const uint32_t *counters, size_t n) {
+#if defined(COUNTER_SCAN_AVX2)
+    if (has_avx2()) {
+        return argmin_avx2(counters, n);
+    }
+#elif defined(COUNTER_SCAN_NEON)
+    return argmin_neon(counters, n);
+#endif
+    return argmin_scalar(counters, n);
+}
+
+/**
+ * Returns the index of the largest counter. Ties go to the lowest index.
+ *
+ * @param counters The counters to search.
+ * @param n Number of counters, at least 1.
+ * @return Index of the largest counter.
+ */
+size_t counter_argmax(const uint32_t *counters, size_t n) {
+#if defined(COUNTER_SCAN_AVX2)
+    if (has_avx2()) {
+        return argmax_avx2(counters, n);
+    }
+#elif defined(COUNTER_SCAN_NEON)
+    return argmax_neon(counters, n);
+#endif
+    return argmax_scalar(counters, n);
+}
+
+/**
+ * Ages shift-register counters by one tick: every counter shifts right and
+ * takes its referenced flag as the new top bit, then the flags are cleared.
+ *
+ * @param counters The counters to age.
+ * @param referenced Per-counter referenced flags, 0 or 1.
+ * @param n Number of counters.
+ * @param bits Width of the counters, from 1 to 32.
+ */
+void counter_age(uint32_t *counters, uint32_t *referenced, size_t n, int bits) {
+#if defined(COUNTER_SCAN_AVX2)
+    if (has_avx2()) {
+        age_avx2(counters, referenced, n, bits);
+        return;
+    }
+#elif defined(COUNTER_SCAN_NEON)
+    age_neon(counters, referenced, n, bits);
+    return;
+#endif
+    age_scalar(counters, referenced, 0, n, bits);
+}
+
+/**
+ * Returns the name of the kernel counter_argmin and counter_argmax use on
+ * this CPU.
+ *
+ * @return "avx2", "neon" or "scalar".
+ */
+const char *counter_scan_kernel(void) {
+#if defined(COUNTER_SCAN_AVX2)
+    if (has_avx2()) {
+        return "avx2";
+    }
+#elif defined(COUNTER_SCAN_NEON)
+    return "neon";
+#endif
+    return "scalar";
+}
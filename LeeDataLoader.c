@@ -2,51 +2,919 @@
  * Helper functions to load a reference string.
  */
 
+#include <limits.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "DataLoader.h"
+#include "Decompress.h"
+#include "StreamVByte.h"
+
+// size of the read buffer used by the text tokenizer
+#define TEXT_BUFFER_SIZE (1 << 16)
+
+// layout of the binary trace header; all fields are little-endian
+static const unsigned char BINARY_MAGIC[4] = {'P', 'R', 'A', 'T'};
+static const unsigned int BINARY_VERSION = 1;
+static const size_t BINARY_HEADER_SIZE = 32;
+// header flag: every reference is preceded by a 32-bit pid
+static const unsigned int BINARY_FLAG_PIDS = 1;
+// header flag: every page is stored as page * 2 + 1 for a write, page * 2 for a read
+static const unsigned int BINARY_FLAG_WRITES = 2;
+
+enum trace_format {
+    TEXT_TRACE = 0,
+    BINARY_TRACE
+};
+
+// streaming reader over a trace file
+struct trace_reader {
+    enum trace_format format;
+    struct trace_header header;
+    // number of references handed out so far
+    long long position;
+
+    // text traces: buffered file and tokenizer state; buffer points either
+    // at file_buffer or at the slot handed out by the decompression stream
+    FILE *fp;
+    unsigned char *file_buffer;
+    const unsigned char *buffer;
+    size_t buffer_pos, buffer_len;
+    // offset of buffer[0] in the uncompressed text
+    long long buffer_offset;
+    // compressed text traces: the decompression pipeline feeding the tokenizer
+    struct decompress_stream *stream;
+    enum compression codec;
+
+    // binary traces: the mapped file, the width of a page number and of a
+    // whole reference in bytes
+    const unsigned char *map;
+    size_t map_size;
+    int width;
+    int record_size;
+
+    // delta-encoded binary traces: offset of the next block in the mapping,
+    // and the references of the current block, which starts at block_start,
+    // not handed out yet
+    enum trace_encoding encoding;
+    size_t block_offset;
+    size_t block_start;
+    int *block_pids, *block_pages;
+    int block_pos, block_len;
+};
+
+// Little-endian helpers
+
+static unsigned int read_u16(const unsigned char *p) {
+    return (unsigned int) p[0] | ((unsigned int) p[1] << 8);
+}
+
+static unsigned int read_u32(const unsigned char *p) {
+    return (unsigned int) p[0] | ((unsigned int) p[1] << 8) |
+           ((unsigned int) p[2] << 16) | ((unsigned int) p[3] << 24);
+}
+
+static unsigned long long read_u64(const unsigned char *p) {
+    return (unsigned long long) read_u32(p) | ((unsigned long long) read_u32(p + 4) << 32);
+}
+
+static void write_u16(unsigned char *p, unsigned int v) {
+    p[0] = (unsigned char) v;
+    p[1] = (unsigned char) (v >> 8);
+}
+
+static void write_u32(unsigned char *p, unsigned int v) {
+    write_u16(p, v & 0xFFFF);
+    write_u16(p + 2, v >> 16);
+}
+
+static void write_u64(unsigned char *p, unsigned long long v) {
+    write_u32(p, (unsigned int) v);
+    write_u32(p + 4, (unsigned int) (v >> 32));
+}
+
+// - End of little-endian helpers
+
+// Text tokenizer
+
+/**
+ * Refills the text buffer from the file, or takes the next decompressed
+ * buffer of a compressed trace.
+ * @param reader the reader to refill
+ * @return number of bytes now available
+ */
+static size_t text_refill(struct trace_reader *reader) {
+    reader->buffer_offset += (long long) reader->buffer_len;
+    reader->buffer_pos = 0;
+    if (reader->stream) {
+        if (decompress_stream_next(reader->stream, &(reader->buffer), &(reader->buffer_len)) != 1) {
+            reader->buffer_len = 0;
+        }
+        return reader->buffer_len;
+    }
+    reader->buffer_len = fread(reader->file_buffer, 1, TEXT_BUFFER_SIZE, reader->fp);
+    return reader->buffer_len;
+}
 
 /**
- * Loads a test_scenario strut from a textfile.
+ * Parses the next whitespace separated integer. This replaces fscanf("%d"),
+ * whose per-call locale and format handling dominates load time on long traces.
+ * @param reader the reader to parse from
+ * @param value receives the parsed integer
+ * @return 1 if an integer was parsed, 0 at the end of the file, -1 on a malformed token
+ */
+static int text_next_int(struct trace_reader *reader, long long *value) {
+    int c;
+    // skip whitespace
+    for (;;) {
+        if (reader->buffer_pos == reader->buffer_len && text_refill(reader) == 0) {
+            return 0;
+        }
+        c = reader->buffer[reader->buffer_pos];
+        if (c != ' ' && c != '\n' && c != '\r' && c != '\t') {
+            break;
+        }
+        reader->buffer_pos++;
+    }
+
+    int negative = 0;
+    if (c == '-') {
+        negative = 1;
+        reader->buffer_pos++;
+    }
+
+    long long result = 0;
+    int digits = 0;
+    for (;;) {
+        if (reader->buffer_pos == reader->buffer_len && text_refill(reader) == 0) {
+            break;
+        }
+        c = reader->buffer[reader->buffer_pos];
+        if (c < '0' || c > '9') {
+            break;
+        }
+        result = result * 10 + (c - '0');
+        digits++;
+        reader->buffer_pos++;
+    }
+    if (digits == 0) {
+        return -1;
+    }
+    *value = negative ? -result : result;
+    return 1;
+}
+
+/**
+ * Reads the three header fields of a text trace.
+ * @param reader the reader to parse from
+ * @return 0 on success, -1 on error
+ */
+static int text_read_header(struct trace_reader *reader) {
+    long long value;
+    if (text_next_int(reader, &value) != 1) {
+        printf("Read of number of pages failed!\n");
+        return -1;
+    }
+    reader->header.page_count = (int) value;
+
+    if (text_next_int(reader, &value) != 1) {
+        printf("Read of number of frames failed!\n");
+        return -1;
+    }
+    reader->header.frame_count = (int) value;
+
+    if (text_next_int(reader, &value) != 1 || value < 0) {
+        printf("Read of number of entries failed!\n");
+        return -1;
+    }
+    reader->header.length = value;
+    return 0;
+}
+
+/**
+ * Reads the next chunk of a text trace. A reference is either a page number
+ * or pid:page; untagged references belong to pid 0. A reference ending in w
+ * is a write, one ending in r or in nothing a read.
+ * @param pids receives the pids, or NULL to drop them
+ * @param writes receives the write flags, or NULL to drop them
+ */
+static int text_next_chunk(struct trace_reader *reader, int *pids, int *pages, unsigned char *writes, int count) {
+    long long value;
+    for (int i = 0; i < count; i++) {
+        if (text_next_int(reader, &value) != 1) {
+            printf("Read of reference string failed!\n");
+            return -1;
+        }
+        int pid = 0;
+        if ((reader->buffer_pos < reader->buffer_len || text_refill(reader) > 0) &&
+            reader->buffer[reader->buffer_pos] == ':') {
+            reader->buffer_pos++;
+            pid = (int) value;
+            if (pid < 0 || text_next_int(reader, &value) != 1) {
+                printf("Read of reference string failed!\n");
+                return -1;
+            }
+            reader->header.has_pids = 1;
+        }
+        unsigned char write = 0;
+        if (reader->buffer_pos < reader->buffer_len || text_refill(reader) > 0) {
+            unsigned char c = reader->buffer[reader->buffer_pos];
+            if (c == 'w' || c == 'W') {
+                write = 1;
+                reader->header.has_writes = 1;
+                reader->buffer_pos++;
+            } else if (c == 'r' || c == 'R') {
+                reader->buffer_pos++;
+            }
+        }
+        if (pids) {
+            pids[i] = pid;
+        }
+        if (writes) {
+            writes[i] = write;
+        }
+        pages[i] = (int) value;
+    }
+    return count;
+}
+
+// - End of text tokenizer
+
+// Binary traces
+
+/**
+ * Maps a binary trace and validates its header.
+ * @param reader the reader to fill in
+ * @param filename the file to map
+ * @return 0 on success, -1 on error
+ */
+static int binary_open(struct trace_reader *reader, const char *filename) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        printf("Cannot open file %s\n", filename);
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t) st.st_size < BINARY_HEADER_SIZE) {
+        printf("Binary trace %s is truncated\n", filename);
+        close(fd);
+        return -1;
+    }
+    void *map = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        printf("Cannot map file %s\n", filename);
+        return -1;
+    }
+    madvise(map, (size_t) st.st_size, MADV_SEQUENTIAL);
+    reader->map = (const unsigned char *) map;
+    reader->map_size = (size_t) st.st_size;
+
+    const unsigned char *h = reader->map;
+    reader->width = (int) read_u16(h + 6);
+    reader->header.has_pids = (read_u32(h + 8) & BINARY_FLAG_PIDS) != 0;
+    reader->header.has_writes = (read_u32(h + 8) & BINARY_FLAG_WRITES) != 0;
+    reader->record_size = reader->width + (reader->header.has_pids ? 4 : 0);
+    reader->header.page_count = (int) read_u32(h + 12);
+    reader->header.frame_count = (int) read_u32(h + 16);
+    reader->encoding = (enum trace_encoding) read_u32(h + 20);
+    reader->header.length = (long long) read_u64(h + 24);
+    if (read_u16(h + 4) != BINARY_VERSION || (reader->width != 2 && reader->width != 4) ||
+        (reader->encoding != PACKED_ENCODING && reader->encoding != DELTA_ENCODING)) {
+        printf("Unsupported binary trace %s\n", filename);
+        return -1;
+    }
+    if (reader->encoding == DELTA_ENCODING) {
+        // blocks are validated as they are decoded
+        reader->block_pids = (int *) malloc(sizeof(int) * TRACE_CHUNK_SIZE);
+        reader->block_pages = (int *) malloc(sizeof(int) * TRACE_CHUNK_SIZE);
+        reader->block_offset = BINARY_HEADER_SIZE;
+        return 0;
+    }
+    if ((reader->map_size - BINARY_HEADER_SIZE) / reader->record_size < (size_t) reader->header.length) {
+        printf("Binary trace %s is truncated\n", filename);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Reads the next chunk of a binary trace straight out of the mapping.
+ * @param pids receives the pids, or NULL to drop them
+ */
+static int binary_next_chunk(struct trace_reader *reader, int *pids, int *pages, int count) {
+    const unsigned char *src = reader->map + BINARY_HEADER_SIZE + reader->position * reader->record_size;
+    if (reader->header.has_pids) {
+        // pid and page records
+        for (int i = 0; i < count; i++) {
+            const unsigned char *record = src + (size_t) i * reader->record_size;
+            if (pids) {
+                pids[i] = (int) read_u32(record);
+            }
+            pages[i] = (int) (reader->width == 2 ? read_u16(record + 4) : read_u32(record + 4));
+        }
+        return count;
+    }
+    if (pids) {
+        memset(pids, 0, sizeof(int) * count);
+    }
+    if (reader->width == 2) {
+        for (int i = 0; i < count; i++) {
+            pages[i] = (int) read_u16(src + 2 * i);
+        }
+    } else {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        memcpy(pages, src, sizeof(int) * count);
+#else
+        for (int i = 0; i < count; i++) {
+            pages[i] = (int) read_u32(src + 4 * i);
+        }
+#endif
+    }
+    return count;
+}
+
+// - End of binary traces
+
+// Delta-encoded binary traces
+
+/**
+ * Returns the number of references in the next block of a delta-encoded
+ * trace. A block is a 32-bit reference count followed by the pid stream, for
+ * multi-process traces, and the page stream; a stream is its 32-bit length in
+ * bytes followed by the Stream-VByte zigzag deltas.
+ * @param reader the reader to peek into
+ * @return number of references, -1 if the block is corrupt
+ */
+static int delta_block_refs(const struct trace_reader *reader) {
+    if (reader->map_size - reader->block_offset < 4) {
+        return -1;
+    }
+    unsigned int refs = read_u32(reader->map + reader->block_offset);
+    return refs == 0 || refs > TRACE_CHUNK_SIZE ? -1 : (int) refs;
+}
+
+/**
+ * Decodes one stream of a block.
+ * @param p the stream; advanced past it
+ * @param out receives the values, or NULL to skip the stream
+ * @return 0 on success, -1 if the stream is corrupt
+ */
+static int delta_decode_stream(const struct trace_reader *reader, const unsigned char **p, int refs, int *out) {
+    size_t available = reader->map_size - (size_t) (*p - reader->map);
+    if (available < 4 || available - 4 < read_u32(*p)) {
+        return -1;
+    }
+    size_t len = read_u32(*p);
+    if (out && stream_vbyte_decode_delta(*p + 4, len, (size_t) refs, out) != len) {
+        return -1;
+    }
+    *p += 4 + len;
+    return 0;
+}
+
+/**
+ * Decodes the next block of a delta-encoded trace.
+ * @param refs the reference count of the block, from delta_block_refs
+ * @param pids receives the pids, or NULL to skip them
+ * @param pages receives the references
+ * @return 0 on success, -1 if the block is corrupt
+ */
+static int delta_decode_block(struct trace_reader *reader, int refs, int *pids, int *pages) {
+    const unsigned char *p = reader->map + reader->block_offset + 4;
+    if (reader->header.has_pids) {
+        if (delta_decode_stream(reader, &p, refs, pids) != 0) {
+            return -1;
+        }
+    } else if (pids) {
+        memset(pids, 0, sizeof(int) * refs);
+    }
+    if (delta_decode_stream(reader, &p, refs, pages) != 0) {
+        return -1;
+    }
+    reader->block_start = reader->block_offset;
+    reader->block_offset = (size_t) (p - reader->map);
+    return 0;
+}
+
+/**
+ * Reads the next chunk of a delta-encoded trace. Blocks that fit the chunk
+ * are decoded straight into it; the others go through the block buffer.
+ * @param pids receives the pids, or NULL to drop them
+ */
+static int delta_next_chunk(struct trace_reader *reader, int *pids, int *pages, int count) {
+    int done = 0;
+    while (done < count) {
+        if (reader->block_pos == reader->block_len) {
+            int refs = delta_block_refs(reader);
+            if (refs > 0 && refs <= count - done) {
+                if (delta_decode_block(reader, refs, pids ? pids + done : NULL, pages + done) != 0) {
+                    printf("Binary trace is corrupt\n");
+                    return -1;
+                }
+                done += refs;
+                continue;
+            }
+            if (refs < 0 || delta_decode_block(reader, refs, reader->block_pids, reader->block_pages) != 0) {
+                printf("Binary trace is corrupt\n");
+                return -1;
+            }
+            reader->block_pos = 0;
+            reader->block_len = refs;
+        }
+        int n = reader->block_len - reader->block_pos;
+        if (n > count - done) {
+            n = count - done;
+        }
+        memcpy(pages + done, reader->block_pages + reader->block_pos, sizeof(int) * n);
+        if (pids) {
+            memcpy(pids + done, reader->block_pids + reader->block_pos, sizeof(int) * n);
+        }
+        reader->block_pos += n;
+        done += n;
+    }
+    return count;
+}
+
+// - End of delta-encoded binary traces
+
+/**
+ * Loads a test_scenario strut from a textfile. The whole reference string is
+ * kept in memory; use a trace_reader for long traces.
  *
  * @param filename The name of the file to load.
  * @return A struct containing the loaded file.
  */
 struct test_scenario* load_test_data(char* filename) {
+    struct trace_reader *reader = trace_reader_open(filename);
+    if (!reader) {
+        return NULL;
+    }
+
+    const struct trace_header *header = trace_reader_header(reader);
     struct test_scenario *ts = (struct test_scenario *) malloc(sizeof(struct test_scenario));
-    FILE *fp = fopen(filename, "r");
+    ts->page_count = header->page_count;
+    ts->frame_count = header->frame_count;
+    ts->refstr_len = (int) header->length;
+    ts->refstr = (int *) malloc(sizeof(int) * (ts->refstr_len > 0 ? ts->refstr_len : 1));
+
+    int loaded = 0;
+    while (loaded < ts->refstr_len) {
+        int n = trace_reader_next_chunk(reader, ts->refstr + loaded, ts->refstr_len - loaded);
+        if (n <= 0) {
+            printf("Read of reference string failed!\n");
+            trace_reader_close(&reader);
+            test_data_destroy(&ts);
+            return NULL;
+        }
+        loaded += n;
+    }
+
+    trace_reader_close(&reader);
+    return ts;
+}
+
+/**
+ * Destroys a test_scenario loaded by load_test_data. Sets outside variable to
+ * NULL.
+ *
+ * @param ts A test_scenario object.
+ */
+void test_data_destroy(struct test_scenario** ts) {
+    free((*ts)->refstr);
+    free(*ts);
+    *ts = NULL;
+}
+
+/**
+ * Opens a trace file for streaming. Only the header is read up front; the
+ * reference string is handed out in chunks by trace_reader_next_chunk, so
+ * memory use does not depend on the length of the trace.
+ *
+ * @param filename The name of the file to open.
+ * @return A trace_reader object, or NULL if the file could not be opened.
+ */
+struct trace_reader* trace_reader_open(char* filename) {
+    FILE *fp = fopen(filename, "rb");
     if (!fp) {
         printf("Cannot open file %s\n", filename);
         return NULL;
     }
 
-    int num_matched = fscanf(fp, "%d", &(ts->page_count));
-    if (num_matched != 1) {
-        printf("Read of number of pages failed!\n");
-        return NULL;
+    struct trace_reader *reader = (struct trace_reader *) calloc(1, sizeof(struct trace_reader));
+    unsigned char magic[sizeof(BINARY_MAGIC)];
+    size_t magic_len = fread(magic, 1, sizeof(magic), fp);
+    if (magic_len == sizeof(magic) && memcmp(magic, BINARY_MAGIC, sizeof(magic)) == 0) {
+        fclose(fp);
+        reader->format = BINARY_TRACE;
+        if (binary_open(reader, filename) != 0) {
+            trace_reader_close(&reader);
+            return NULL;
+        }
+        return reader;
     }
 
-    num_matched = fscanf(fp, "%d", &(ts->frame_count));
-    if (num_matched != 1) {
-        printf("Read of number of frames failed!\n");
-        return NULL;
+    reader->format = TEXT_TRACE;
+    enum compression codec = decompress_detect(magic, magic_len);
+    if (codec != NO_COMPRESSION) {
+        reader->codec = codec;
+        reader->stream = decompress_stream_open(fp, codec);
+        if (!reader->stream) {
+            trace_reader_close(&reader);
+            return NULL;
+        }
+        if (text_refill(reader) >= sizeof(BINARY_MAGIC) &&
+            memcmp(reader->buffer, BINARY_MAGIC, sizeof(BINARY_MAGIC)) == 0) {
+            printf("Compressed trace %s holds a binary trace; compress the text trace instead\n", filename);
+            trace_reader_close(&reader);
+            return NULL;
+        }
+        // the first buffer is already in place, no need to restart the stream
+        if (text_read_header(reader) != 0) {
+            trace_reader_close(&reader);
+            return NULL;
+        }
+        return reader;
     }
 
-    int refstr_len;
-    num_matched = fscanf(fp, "%d", &(refstr_len));
-    if (num_matched != 1) {
-        printf("Read of number of entries failed!\n");
+    reader->fp = fp;
+    reader->file_buffer = (unsigned char *) malloc(TEXT_BUFFER_SIZE);
+    reader->buffer = reader->file_buffer;
+    if (trace_reader_rewind(reader) != 0) {
+        trace_reader_close(&reader);
         return NULL;
     }
+    return reader;
+}
 
-    ts->refstr_len = refstr_len;
-    for (int i = 0; i < refstr_len; i++) {
-        num_matched = fscanf(fp, "%d", &(ts->refstr[i]));
-        if (num_matched != 1) {
-            printf("Read of reference string failed!\n");
-            return NULL;
+/**
+ * Closes a trace_reader. Sets outside variable to NULL.
+ *
+ * @param reader A trace_reader object.
+ */
+void trace_reader_close(struct trace_reader** reader) {
+    if ((*reader)->fp) {
+        fclose((*reader)->fp);
+    }
+    if ((*reader)->stream) {
+        decompress_stream_close(&((*reader)->stream));
+    }
+    free((*reader)->file_buffer);
+    free((*reader)->block_pids);
+    free((*reader)->block_pages);
+    if ((*reader)->map) {
+        munmap((void *) (*reader)->map, (*reader)->map_size);
+    }
+    free(*reader);
+    *reader = NULL;
+}
+
+/**
+ * Returns the header of the trace being read.
+ *
+ * @param reader A trace_reader object.
+ * @return The header of the trace.
+ */
+const struct trace_header* trace_reader_header(const struct trace_reader* reader) {
+    return &(reader->header);
+}
+
+/**
+ * Returns the name of the format of the trace being read: "text", "zstd" or
+ * "lz4" for text traces, "packed" or "delta" for binary traces.
+ *
+ * @param reader A trace_reader object.
+ * @return The name of the format.
+ */
+const char* trace_reader_format_name(const struct trace_reader* reader) {
+    if (reader->format == BINARY_TRACE) {
+        return reader->encoding == DELTA_ENCODING ? "delta" : "packed";
+    }
+    switch (reader->codec) {
+        case ZSTD_COMPRESSION:
+            return "zstd";
+        case LZ4_COMPRESSION:
+            return "lz4";
+        default:
+            return "text";
+    }
+}
+
+/**
+ * Reads the next chunk of a trace in whatever format it has. Binary traces
+ * with write flags are read as stored and split into pages and flags here.
+ * @param pids receives the pids, or NULL to drop them
+ * @param writes receives the write flags, or NULL to drop them
+ */
+static int next_chunk(struct trace_reader *reader, int *pids, int *pages, unsigned char *writes, int max_pages) {
+    long long remaining = reader->header.length - reader->position;
+    int count = remaining < max_pages ? (int) remaining : max_pages;
+    if (count == 0) {
+        return 0;
+    }
+    if (reader->format == BINARY_TRACE && reader->encoding == DELTA_ENCODING) {
+        count = delta_next_chunk(reader, pids, pages, count);
+    } else if (reader->format == BINARY_TRACE) {
+        count = binary_next_chunk(reader, pids, pages, count);
+    } else {
+        count = text_next_chunk(reader, pids, pages, writes, count);
+    }
+    if (count > 0 && reader->format == BINARY_TRACE && reader->header.has_writes) {
+        for (int i = 0; i < count; i++) {
+            if (writes) {
+                writes[i] = (unsigned char) (pages[i] & 1);
+            }
+            pages[i] = (int) ((unsigned int) pages[i] >> 1);
         }
+    } else if (count > 0 && reader->format == BINARY_TRACE && writes) {
+        memset(writes, 0, (size_t) count);
+    }
+    if (count > 0) {
+        reader->position += count;
     }
+    return count;
+}
 
-    fclose(fp);
+/**
+ * Reads the next chunk of references from a trace.
+ *
+ * @param reader A trace_reader object.
+ * @param pages Buffer receiving the references.
+ * @param max_pages Capacity of pages; TRACE_CHUNK_SIZE is a good choice.
+ * @return Number of references read, 0 at the end of the trace, -1 on error.
+ */
+int trace_reader_next_chunk(struct trace_reader* reader, int* pages, int max_pages) {
+    return next_chunk(reader, NULL, pages, NULL, max_pages);
+}
 
-    return ts;
-}
\ No newline at end of file
+/**
+ * Reads the next chunk of references from a trace together with the pid of
+ * every reference. References without a pid belong to pid 0.
+ *
+ * @param reader A trace_reader object.
+ * @param pids Buffer receiving the pids, or NULL.
+ * @param pages Buffer receiving the references.
+ * @param max_pages Capacity of pids and pages.
+ * @return Number of references read, 0 at the end of the trace, -1 on error.
+ */
+int trace_reader_next_chunk_pids(struct trace_reader* reader, int* pids, int* pages, int max_pages) {
+    return next_chunk(reader, pids, pages, NULL, max_pages);
+}
+
+/**
+ * Reads the next chunk of references from a trace together with whether
+ * every reference is a write. Traces without write flags only hold reads.
+ *
+ * @param reader A trace_reader object.
+ * @param pages Buffer receiving the references.
+ * @param writes Buffer receiving 1 for a write and 0 for a read.
+ * @param max_pages Capacity of pages and writes.
+ * @return Number of references read, 0 at the end of the trace, -1 on error.
+ */
+int trace_reader_next_chunk_writes(struct trace_reader* reader, int* pages, unsigned char* writes, int max_pages) {
+    return next_chunk(reader, NULL, pages, writes, max_pages);
+}
+
+/**
+ * Restarts reading at the first reference of the trace.
+ *
+ * @param reader A trace_reader object.
+ * @return 0 on success, -1 on error.
+ */
+int trace_reader_rewind(struct trace_reader* reader) {
+    reader->position = 0;
+    if (reader->format == BINARY_TRACE) {
+        reader->block_offset = BINARY_HEADER_SIZE;
+        reader->block_pos = reader->block_len = 0;
+        return 0;
+    }
+    if (reader->stream) {
+        if (decompress_stream_rewind(reader->stream) != 0) {
+            return -1;
+        }
+    } else if (fseek(reader->fp, 0, SEEK_SET) != 0) {
+        return -1;
+    }
+    reader->buffer_pos = reader->buffer_len = 0;
+    reader->buffer_offset = 0;
+    return text_read_header(reader);
+}
+
+/**
+ * Records where a reader is in its trace, to resume there later with
+ * trace_reader_seek, possibly from another reader of the same trace.
+ *
+ * @param reader A trace_reader object.
+ * @param mark Receives the position.
+ */
+void trace_reader_tell(const struct trace_reader* reader, struct trace_mark* mark) {
+    mark->position = reader->position;
+    mark->skip = 0;
+    if (reader->format == TEXT_TRACE) {
+        mark->offset = reader->buffer_offset + (long long) reader->buffer_pos;
+    } else if (reader->encoding == PACKED_ENCODING) {
+        mark->offset = (long long) BINARY_HEADER_SIZE + reader->position * reader->record_size;
+    } else if (reader->block_pos < reader->block_len) {
+        // part of the buffered block is handed out already
+        mark->offset = (long long) reader->block_start;
+        mark->skip = reader->block_pos;
+    } else {
+        mark->offset = (long long) reader->block_offset;
+    }
+}
+
+/**
+ * Continues reading where trace_reader_tell left off. Uncompressed text and
+ * binary traces seek straight to the byte offset; compressed text traces are
+ * decompressed again up to it.
+ *
+ * @param reader A trace_reader object.
+ * @param mark A position recorded on the same trace.
+ * @return 0 on success, -1 if the mark does not fit the trace or on error.
+ */
+int trace_reader_seek(struct trace_reader* reader, const struct trace_mark* mark) {
+    if (mark->position < 0 || mark->position > reader->header.length || mark->offset < 0 || mark->skip < 0) {
+        printf("Trace position %lld is outside the trace\n", mark->position);
+        return -1;
+    }
+    if (reader->format == BINARY_TRACE && reader->encoding == PACKED_ENCODING) {
+        if (mark->offset != (long long) BINARY_HEADER_SIZE + mark->position * reader->record_size) {
+            printf("Trace position %lld does not match its offset\n", mark->position);
+            return -1;
+        }
+        reader->position = mark->position;
+        return 0;
+    }
+    if (reader->format == BINARY_TRACE) {
+        if ((size_t) mark->offset < BINARY_HEADER_SIZE || (size_t) mark->offset > reader->map_size) {
+            printf("Trace position %lld does not match its offset\n", mark->position);
+            return -1;
+        }
+        reader->block_offset = (size_t) mark->offset;
+        reader->block_pos = reader->block_len = 0;
+        reader->position = mark->position;
+        if (mark->skip > 0) {
+            int refs = delta_block_refs(reader);
+            if (refs <= mark->skip ||
+                delta_decode_block(reader, refs, reader->block_pids, reader->block_pages) != 0) {
+                printf("Trace position %lld does not match its offset\n", mark->position);
+                return -1;
+            }
+            reader->block_len = refs;
+            reader->block_pos = mark->skip;
+        }
+        return 0;
+    }
+
+    if (reader->stream) {
+        // decompressed text can only be read front to back
+        if (decompress_stream_rewind(reader->stream) != 0) {
+            return -1;
+        }
+        reader->buffer_pos = reader->buffer_len = 0;
+        reader->buffer_offset = 0;
+        while (reader->buffer_offset + (long long) reader->buffer_len < mark->offset) {
+            if (text_refill(reader) == 0) {
+                printf("Trace position %lld does not match its offset\n", mark->position);
+                return -1;
+            }
+        }
+        reader->buffer_pos = (size_t) (mark->offset - reader->buffer_offset);
+    } else {
+        if (fseek(reader->fp, (long) mark->offset, SEEK_SET) != 0) {
+            return -1;
+        }
+        reader->buffer_pos = reader->buffer_len = 0;
+        reader->buffer_offset = mark->offset;
+    }
+    reader->position = mark->position;
+    return 0;
+}
+
+/**
+ * Writes one block of a delta-encoded trace: the reference count, the pid
+ * stream for multi-process traces and the page stream.
+ * @param out receives the block, at least 12 + 2 * stream_vbyte_max_size(n) bytes
+ * @return number of bytes written
+ */
+static size_t delta_encode_block(const int *pids, const int *pages, int n, int has_pids, unsigned char *out) {
+    unsigned char *p = out;
+    write_u32(p, (unsigned int) n);
+    p += 4;
+    if (has_pids) {
+        size_t len = stream_vbyte_encode_delta(pids, (size_t) n, p + 4);
+        write_u32(p, (unsigned int) len);
+        p += 4 + len;
+    }
+    size_t len = stream_vbyte_encode_delta(pages, (size_t) n, p + 4);
+    write_u32(p, (unsigned int) len);
+    p += 4 + len;
+    return (size_t) (p - out);
+}
+
+/**
+ * Converts a text trace into the binary trace format. Packed traces store
+ * references as 16-bit page numbers when page_count allows it, 32-bit
+ * otherwise; delta-encoded traces store blocks of Stream-VByte zigzag
+ * deltas. A trace with any pid:page reference is written with a pid for
+ * every page, and a trace with any write carries a write flag in every page.
+ *
+ * @param text_filename The text trace to convert.
+ * @param binary_filename The binary trace to write.
+ * @param encoding How references are stored.
+ * @return 0 on success, -1 on error.
+ */
+int trace_convert_to_binary(char* text_filename, char* binary_filename, enum trace_encoding encoding) {
+    struct trace_reader *reader = trace_reader_open(text_filename);
+    if (!reader) {
+        return -1;
+    }
+    FILE *out = fopen(binary_filename, "wb");
+    if (!out) {
+        printf("Cannot open file %s\n", binary_filename);
+        trace_reader_close(&reader);
+        return -1;
+    }
+
+    const struct trace_header *header = trace_reader_header(reader);
+    int pids[TRACE_CHUNK_SIZE];
+    int chunk[TRACE_CHUNK_SIZE];
+    unsigned char writes[TRACE_CHUNK_SIZE];
+    // a pid or a write anywhere in the trace gives every reference one
+    while (!(header->has_pids && header->has_writes) &&
+           trace_reader_next_chunk(reader, chunk, TRACE_CHUNK_SIZE) > 0) {
+        // text traces only say so once the reference has been read
+    }
+    int has_pids = header->has_pids;
+    int has_writes = header->has_writes;
+    if (trace_reader_rewind(reader) != 0 || (has_writes && header->page_count > INT_MAX / 2)) {
+        printf("Cannot convert trace %s\n", text_filename);
+        fclose(out);
+        trace_reader_close(&reader);
+        return -1;
+    }
+    int width = header->page_count <= (has_writes ? 0x8000 : 0x10000) && encoding == PACKED_ENCODING ? 2 : 4;
+    int n = next_chunk(reader, pids, chunk, writes, TRACE_CHUNK_SIZE);
+    int record_size = width + (has_pids ? 4 : 0);
+    unsigned char h[32] = {0};
+    memcpy(h, BINARY_MAGIC, sizeof(BINARY_MAGIC));
+    write_u16(h + 4, BINARY_VERSION);
+    write_u16(h + 6, (unsigned int) width);
+    write_u32(h + 8, (has_pids ? BINARY_FLAG_PIDS : 0) | (has_writes ? BINARY_FLAG_WRITES : 0));
+    write_u32(h + 12, (unsigned int) header->page_count);
+    write_u32(h + 16, (unsigned int) header->frame_count);
+    write_u32(h + 20, (unsigned int) encoding);
+    write_u64(h + 24, (unsigned long long) header->length);
+    int status = fwrite(h, 1, BINARY_HEADER_SIZE, out) == BINARY_HEADER_SIZE ? 0 : -1;
+
+    unsigned char packed[TRACE_CHUNK_SIZE * 11];
+    while (status == 0 && n != 0) {
+        if (n < 0) {
+            status = -1;
+            break;
+        }
+        for (int i = 0; i < n; i++) {
+            if (chunk[i] < 0 || chunk[i] >= header->page_count) {
+                printf("Page %d is out of range\n", chunk[i]);
+                status = -1;
+                break;
+            }
+            if (has_writes) {
+                chunk[i] = chunk[i] * 2 + writes[i];
+            }
+        }
+        size_t size = 0;
+        if (status == 0 && encoding == DELTA_ENCODING) {
+            size = delta_encode_block(pids, chunk, n, has_pids, packed);
+        } else if (status == 0) {
+            for (int i = 0; i < n; i++) {
+                unsigned char *record = packed + (size_t) i * record_size;
+                if (has_pids) {
+                    write_u32(record, (unsigned int) pids[i]);
+                    record += 4;
+                }
+                if (width == 2) {
+                    write_u16(record, (unsigned int) chunk[i]);
+                } else {
+                    write_u32(record, (unsigned int) chunk[i]);
+                }
+            }
+            size = (size_t) record_size * n;
+        }
+        if (status == 0 && fwrite(packed, 1, size, out) != size) {
+            status = -1;
+        }
+        if (status == 0) {
+            n = next_chunk(reader, pids, chunk, writes, TRACE_CHUNK_SIZE);
+        }
+    }
+
+    if (fclose(out) != 0) {
+        status = -1;
+    }
+    trace_reader_close(&reader);
+    return status;
+}
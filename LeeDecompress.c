@@ -0,0 +1,472 @@
+/*
+ * Decompression pipeline for compressed traces.
+ *
+ * The producer thread owns the codec and the file; it fills whole slots of
+ * the ring and publishes them under the lock. The reader holds at most one
+ * slot at a time, which stays counted as filled until the reader asks for the
+ * next one, so the producer never overwrites bytes that are being parsed.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "Decompress.h"
+
+#if defined(PRA_HAVE_ZSTD) || defined(PRA_HAVE_LZ4)
+#include <pthread.h>
+#endif
+#ifdef PRA_HAVE_ZSTD
+#include <zstd.h>
+#endif
+#ifdef PRA_HAVE_LZ4
+#include <lz4frame.h>
+#endif
+
+// frame magics, as they appear at the start of the file
+static const unsigned char ZSTD_MAGIC[4] = {0x28, 0xB5, 0x2F, 0xFD};
+static const unsigned char LZ4_MAGIC[4] = {0x04, 0x22, 0x4D, 0x18};
+
+/**
+ * Recognizes a compressed file from its first bytes.
+ *
+ * @param magic The first bytes of the file.
+ * @param len Number of bytes in magic.
+ * @return The compression format, NO_COMPRESSION if none is recognized.
+ */
+enum compression decompress_detect(const unsigned char* magic, size_t len) {
+    if (len >= sizeof(ZSTD_MAGIC) && memcmp(magic, ZSTD_MAGIC, sizeof(ZSTD_MAGIC)) == 0) {
+        return ZSTD_COMPRESSION;
+    }
+    if (len >= sizeof(LZ4_MAGIC) && memcmp(magic, LZ4_MAGIC, sizeof(LZ4_MAGIC)) == 0) {
+        return LZ4_COMPRESSION;
+    }
+    return NO_COMPRESSION;
+}
+
+/**
+ * Returns the name of a compression format.
+ *
+ * @param codec A compression format.
+ * @return The name of the format.
+ */
+const char* decompress_name(enum compression codec) {
+    switch (codec) {
+        case ZSTD_COMPRESSION:
+            return "zstd";
+        case LZ4_COMPRESSION:
+            return "LZ4";
+        default:
+            return "uncompressed";
+    }
+}
+
+#if defined(PRA_HAVE_ZSTD) || defined(PRA_HAVE_LZ4)
+
+// size of the compressed input buffer
+#define INPUT_BUFFER_SIZE (1 << 17)
+
+struct decompress_stream {
+    enum compression codec;
+    FILE *fp;
+
+    // producer side: codec context and compressed input
+    void *context;
+    unsigned char *input;
+    size_t input_pos, input_len;
+    int input_eof;
+    // last return value of the codec; nonzero while a frame is incomplete
+    size_t frame_pending;
+
+    // ring of decompressed buffers; head is the next slot to read, tail the
+    // next one to fill
+    unsigned char *slots[DECOMPRESS_SLOTS];
+    size_t slot_len[DECOMPRESS_SLOTS];
+    int head, tail, filled;
+    // nonzero while the reader holds the slot at head
+    int held;
+    // set by the producer once the stream has ended, and if it failed
+    int finished, failed;
+    // set by the reader to stop the producer
+    int cancelled;
+
+    pthread_t thread;
+    int running;
+    pthread_mutex_t lock;
+    pthread_cond_t readable, writable;
+};
+
+// Codecs
+
+/**
+ * Reads more compressed input once the current input has been consumed.
+ * @param ds the stream to read for
+ */
+static void refill_input(struct decompress_stream *ds) {
+    if (ds->input_pos == ds->input_len && !ds->input_eof) {
+        ds->input_len = fread(ds->input, 1, INPUT_BUFFER_SIZE, ds->fp);
+        ds->input_pos = 0;
+        ds->input_eof = ds->input_len == 0;
+    }
+}
+
+#ifdef PRA_HAVE_ZSTD
+/**
+ * Decompresses zstd frames into dst.
+ * @param ds the stream to decompress
+ * @param dst the buffer to fill
+ * @param cap capacity of dst
+ * @return number of bytes written, -1 on error
+ */
+static long zstd_decode(struct decompress_stream *ds, unsigned char *dst, size_t cap) {
+    ZSTD_inBuffer in = {ds->input, ds->input_len, ds->input_pos};
+    ZSTD_outBuffer out = {dst, cap, 0};
+    // an empty input at the end of the file still flushes buffered output
+    size_t ret = ZSTD_decompressStream((ZSTD_DCtx *) ds->context, &out, &in);
+    if (ZSTD_isError(ret)) {
+        printf("Corrupt zstd trace: %s\n", ZSTD_getErrorName(ret));
+        return -1;
+    }
+    ds->input_pos = in.pos;
+    ds->frame_pending = ret;
+    return (long) out.pos;
+}
+#endif
+
+#ifdef PRA_HAVE_LZ4
+/**
+ * Decompresses LZ4 frames into dst.
+ * @param ds the stream to decompress
+ * @param dst the buffer to fill
+ * @param cap capacity of dst
+ * @return number of bytes written, -1 on error
+ */
+static long lz4_decode(struct decompress_stream *ds, unsigned char *dst, size_t cap) {
+    size_t out_len = cap;
+    size_t in_len = ds->input_len - ds->input_pos;
+    size_t ret = LZ4F_decompress((LZ4F_dctx *) ds->context, dst, &out_len,
+                                 ds->input + ds->input_pos, &in_len, NULL);
+    if (LZ4F_isError(ret)) {
+        printf("Corrupt LZ4 trace: %s\n", LZ4F_getErrorName(ret));
+        return -1;
+    }
+    ds->input_pos += in_len;
+    ds->frame_pending = ret;
+    return (long) out_len;
+}
+#endif
+
+/**
+ * Creates a fresh codec context and forgets any buffered input.
+ * @param ds the stream to reset
+ * @return 0 on success, -1 on error
+ */
+static int codec_init(struct decompress_stream *ds) {
+    ds->input_pos = ds->input_len = 0;
+    ds->input_eof = 0;
+    ds->frame_pending = 0;
+#ifdef PRA_HAVE_ZSTD
+    if (ds->codec == ZSTD_COMPRESSION) {
+        ds->context = ZSTD_createDCtx();
+        return ds->context ? 0 : -1;
+    }
+#endif
+#ifdef PRA_HAVE_LZ4
+    if (ds->codec == LZ4_COMPRESSION) {
+        LZ4F_dctx *context = NULL;
+        if (LZ4F_isError(LZ4F_createDecompressionContext(&context, LZ4F_VERSION))) {
+            return -1;
+        }
+        ds->context = context;
+        return 0;
+    }
+#endif
+    return -1;
+}
+
+/**
+ * Frees the codec context.
+ * @param ds the stream to clean up
+ */
+static void codec_free(struct decompress_stream *ds) {
+#ifdef PRA_HAVE_ZSTD
+    if (ds->codec == ZSTD_COMPRESSION) {
+        ZSTD_freeDCtx((ZSTD_DCtx *) ds->context);
+    }
+#endif
+#ifdef PRA_HAVE_LZ4
+    if (ds->codec == LZ4_COMPRESSION) {
+        LZ4F_freeDecompressionContext((LZ4F_dctx *) ds->context);
+    }
+#endif
+    ds->context = NULL;
+}
+
+/**
+ * Fills dst with decompressed bytes, stopping early only at the end of the
+ * input.
+ * @param ds the stream to decompress
+ * @param dst the buffer to fill
+ * @return number of bytes written, -1 on a corrupt or truncated stream
+ */
+static long codec_fill(struct decompress_stream *ds, unsigned char *dst) {
+    size_t fill = 0;
+    while (fill < DECOMPRESS_SLOT_SIZE) {
+        refill_input(ds);
+        if (ds->input_pos == ds->input_len && ds->input_eof && ds->frame_pending == 0) {
+            // every frame is complete
+            break;
+        }
+        long n = -1;
+#ifdef PRA_HAVE_ZSTD
+        if (ds->codec == ZSTD_COMPRESSION) {
+            n = zstd_decode(ds, dst + fill, DECOMPRESS_SLOT_SIZE - fill);
+        }
+#endif
+#ifdef PRA_HAVE_LZ4
+        if (ds->codec == LZ4_COMPRESSION) {
+            n = lz4_decode(ds, dst + fill, DECOMPRESS_SLOT_SIZE - fill);
+        }
+#endif
+        if (n < 0) {
+            return -1;
+        }
+        if (n == 0 && ds->input_pos == ds->input_len && ds->input_eof) {
+            printf("Compressed trace is truncated\n");
+            return -1;
+        }
+        fill += (size_t) n;
+    }
+    return (long) fill;
+}
+
+// - End of codecs
+
+// Producer thread
+
+/**
+ * Decompresses the whole file into the ring, one slot at a time.
+ * @param arg the decompress_stream
+ * @return NULL
+ */
+static void *producer_main(void *arg) {
+    struct decompress_stream *ds = (struct decompress_stream *) arg;
+    int failed = 0;
+    for (;;) {
+        pthread_mutex_lock(&(ds->lock));
+        while (ds->filled == DECOMPRESS_SLOTS && !ds->cancelled) {
+            pthread_cond_wait(&(ds->writable), &(ds->lock));
+        }
+        int cancelled = ds->cancelled;
+        int slot = ds->tail;
+        pthread_mutex_unlock(&(ds->lock));
+        if (cancelled) {
+            return NULL;
+        }
+
+        // the slot at tail is invisible to the reader until it is published
+        long n = codec_fill(ds, ds->slots[slot]);
+        if (n <= 0) {
+            failed = n < 0;
+            break;
+        }
+        pthread_mutex_lock(&(ds->lock));
+        ds->slot_len[slot] = (size_t) n;
+        ds->tail = (slot + 1) % DECOMPRESS_SLOTS;
+        ds->filled++;
+        pthread_cond_signal(&(ds->readable));
+        pthread_mutex_unlock(&(ds->lock));
+        if (n < DECOMPRESS_SLOT_SIZE) {
+            break;
+        }
+    }
+
+    pthread_mutex_lock(&(ds->lock));
+    ds->finished = 1;
+    ds->failed = failed;
+    pthread_cond_signal(&(ds->readable));
+    pthread_mutex_unlock(&(ds->lock));
+    return NULL;
+}
+
+/**
+ * Empties the ring and starts the producer at the current file position.
+ * @param ds the stream to start
+ * @return 0 on success, -1 on error
+ */
+static int producer_start(struct decompress_stream *ds) {
+    ds->head = ds->tail = ds->filled = 0;
+    ds->held = ds->finished = ds->failed = ds->cancelled = 0;
+    if (codec_init(ds) != 0) {
+        printf("Cannot create %s decoder\n", decompress_name(ds->codec));
+        return -1;
+    }
+    if (pthread_create(&(ds->thread), NULL, producer_main, ds) != 0) {
+        printf("Cannot start decompression thread\n");
+        codec_free(ds);
+        return -1;
+    }
+    ds->running = 1;
+    return 0;
+}
+
+/**
+ * Stops the producer and waits for it to exit.
+ * @param ds the stream to stop
+ */
+static void producer_stop(struct decompress_stream *ds) {
+    if (!ds->running) {
+        return;
+    }
+    pthread_mutex_lock(&(ds->lock));
+    ds->cancelled = 1;
+    pthread_cond_signal(&(ds->writable));
+    pthread_mutex_unlock(&(ds->lock));
+    pthread_join(ds->thread, NULL);
+    ds->running = 0;
+    codec_free(ds);
+}
+
+// - End of producer thread
+
+/**
+ * Starts decompressing a file. The stream takes ownership of fp, which is
+ * read from the beginning.
+ *
+ * @param fp The compressed file.
+ * @param codec The compression format of the file.
+ * @return A decompress_stream object, or NULL if the codec was not built in.
+ */
+struct decompress_stream* decompress_stream_open(FILE* fp, enum compression codec) {
+    int supported = 0;
+#ifdef PRA_HAVE_ZSTD
+    supported |= codec == ZSTD_COMPRESSION;
+#endif
+#ifdef PRA_HAVE_LZ4
+    supported |= codec == LZ4_COMPRESSION;
+#endif
+    if (!supported) {
+        printf("This build cannot read %s-compressed traces\n", decompress_name(codec));
+        fclose(fp);
+        return NULL;
+    }
+
+    struct decompress_stream *ds = (struct decompress_stream *) calloc(1, sizeof(struct decompress_stream));
+    ds->codec = codec;
+    ds->fp = fp;
+    ds->input = (unsigned char *) malloc(INPUT_BUFFER_SIZE);
+    for (int i = 0; i < DECOMPRESS_SLOTS; i++) {
+        ds->slots[i] = (unsigned char *) malloc(DECOMPRESS_SLOT_SIZE);
+    }
+    pthread_mutex_init(&(ds->lock), NULL);
+    pthread_cond_init(&(ds->readable), NULL);
+    pthread_cond_init(&(ds->writable), NULL);
+
+    if (fseek(fp, 0, SEEK_SET) != 0 || producer_start(ds) != 0) {
+        decompress_stream_close(&ds);
+        return NULL;
+    }
+    return ds;
+}
+
+/**
+ * Stops the producer thread and closes the file. Sets outside variable to
+ * NULL.
+ *
+ * @param ds A decompress_stream object.
+ */
+void decompress_stream_close(struct decompress_stream** ds) {
+    producer_stop(*ds);
+    pthread_mutex_destroy(&((*ds)->lock));
+    pthread_cond_destroy(&((*ds)->readable));
+    pthread_cond_destroy(&((*ds)->writable));
+    for (int i = 0; i < DECOMPRESS_SLOTS; i++) {
+        free((*ds)->slots[i]);
+    }
+    free((*ds)->input);
+    fclose((*ds)->fp);
+    free(*ds);
+    *ds = NULL;
+}
+
+/**
+ * Hands out the next buffer of decompressed bytes. The buffer stays valid
+ * until the next call, after which the producer may reuse it.
+ *
+ * @param ds A decompress_stream object.
+ * @param data Receives the decompressed bytes.
+ * @param len Receives the number of bytes in data.
+ * @return 1 if a buffer was handed out, 0 at the end of the stream, -1 on a
+ * corrupt or truncated stream.
+ */
+int decompress_stream_next(struct decompress_stream* ds, const unsigned char** data, size_t* len) {
+    pthread_mutex_lock(&(ds->lock));
+    if (ds->held) {
+        // give the previous slot back to the producer
+        ds->head = (ds->head + 1) % DECOMPRESS_SLOTS;
+        ds->filled--;
+        ds->held = 0;
+        pthread_cond_signal(&(ds->writable));
+    }
+    while (ds->filled == 0 && !ds->finished) {
+        pthread_cond_wait(&(ds->readable), &(ds->lock));
+    }
+    int result;
+    if (ds->filled > 0) {
+        *data = ds->slots[ds->head];
+        *len = ds->slot_len[ds->head];
+        ds->held = 1;
+        result = 1;
+    } else {
+        *len = 0;
+        result = ds->failed ? -1 : 0;
+    }
+    pthread_mutex_unlock(&(ds->lock));
+    return result;
+}
+
+/**
+ * Restarts decompression at the beginning of the file.
+ *
+ * @param ds A decompress_stream object.
+ * @return 0 on success, -1 on error.
+ */
+int decompress_stream_rewind(struct decompress_stream* ds) {
+    producer_stop(ds);
+    if (fseek(ds->fp, 0, SEEK_SET) != 0) {
+        return -1;
+    }
+    return producer_start(ds);
+}
+
+#else
+
+/**
+ * Starts decompressing a file. Without a codec built in, this only reports
+ * that compressed traces cannot be read.
+ *
+ * @param fp The compressed file.
+ * @param codec The compression format of the file.
+ * @return NULL.
+ */
+struct decompress_stream* decompress_stream_open(FILE* fp, enum compression codec) {
+    printf("This build cannot read %s-compressed traces\n", decompress_name(codec));
+    fclose(fp);
+    return NULL;
+}
+
+void decompress_stream_close(struct decompress_stream** ds) {
+    *ds = NULL;
+}
+
+int decompress_stream_next(struct decompress_stream* ds, const unsigned char** data, size_t* len) {
+    (void) ds;
+    *data = NULL;
+    *len = 0;
+    return -1;
+}
+
+int decompress_stream_rewind(struct decompress_stream* ds) {
+    (void) ds;
+    return -1;
+}
+
+#endif
@@ -0,0 +1,180 @@
+/*
+ * Open-addressing hash map with linear probing.
+ */
+
+#include <string.h>
+#include "IntMap.h"
+
+/**
+ * Returns the home slot of a key (Fibonacci hashing). The slot comes from the
+ * high bits of the product: the low bits only depend on the low bits of the
+ * key, so strided pages would all share a few home slots.
+ */
+static inline unsigned home_slot(const struct int_map *map, int key) {
+    return ((unsigned) key * 0x9E3779B1u) >> map->shift;
+}
+
+/**
+ * Allocates empty storage for the given power-of-two capacity.
+ */
+static void allocate(struct int_map *map, unsigned capacity) {
+    map->capacity = capacity;
+    map->shift = 32;
+    for (unsigned c = capacity; c > 1; c >>= 1) {
+        map->shift--;
+    }
+    map->size = 0;
+    map->keys = (int *) malloc(sizeof(int) * capacity);
+    map->values = (int *) malloc(sizeof(int) * capacity);
+    memset(map->keys, 0xFF, sizeof(int) * capacity);  // every slot INT_MAP_FREE
+}
+
+/**
+ * Doubles the capacity and reinserts every key.
+ */
+static void grow(struct int_map *map) {
+    int *keys = map->keys;
+    int *values = map->values;
+    unsigned capacity = map->capacity;
+    allocate(map, capacity * 2);
+    for (unsigned i = 0; i < capacity; i++) {
+        if (keys[i] != INT_MAP_FREE) {
+            int_map_put(map, keys[i], values[i]);
+        }
+    }
+    free(keys);
+    free(values);
+}
+
+/**
+ * Initializes an empty map sized for the expected number of keys.
+ *
+ * @param map The map to initialize.
+ * @param expected Expected number of keys; the map grows past it as needed.
+ */
+void int_map_init(struct int_map* map, unsigned expected) {
+    unsigned capacity = 16;
+    // keep the load factor at or below one half
+    while (capacity < 2 * expected) {
+        capacity *= 2;
+    }
+    allocate(map, capacity);
+}
+
+/**
+ * Frees the storage of a map.
+ *
+ * @param map The map to free.
+ */
+void int_map_free(struct int_map* map) {
+    free(map->keys);
+    free(map->values);
+    map->keys = map->values = NULL;
+    map->capacity = map->size = 0;
+}
+
+/**
+ * Removes all keys, keeping the storage.
+ *
+ * @param map The map to clear.
+ */
+void int_map_clear(struct int_map* map) {
+    memset(map->keys, 0xFF, sizeof(int) * map->capacity);
+    map->size = 0;
+}
+
+/**
+ * Returns the value stored for a key.
+ *
+ * @param map The map to search.
+ * @param key The key to look up.
+ * @param missing Value returned when the key is not present.
+ * @return The value of the key, or missing.
+ */
+int int_map_get(const struct int_map* map, int key, int missing) {
+    unsigned mask = map->capacity - 1;
+    for (unsigned i = home_slot(map, key);; i = (i + 1) & mask) {
+        int k = map->keys[i];
+        if (k == key) {
+            return map->values[i];
+        }
+        if (k == INT_MAP_FREE) {
+            return missing;
+        }
+    }
+}
+
+/**
+ * Stores a value for a key, replacing any previous value.
+ *
+ * @param map The map to update.
+ * @param key The key to store.
+ * @param value The value to store.
+ */
+void int_map_put(struct int_map* map, int key, int value) {
+    unsigned mask = map->capacity - 1;
+    for (unsigned i = home_slot(map, key);; i = (i + 1) & mask) {
+        int k = map->keys[i];
+        if (k == key) {
+            map->values[i] = value;
+            return;
+        }
+        if (k == INT_MAP_FREE) {
+            map->keys[i] = key;
+            map->values[i] = value;
+            if (++(map->size) * 2 > map->capacity) {
+                grow(map);
+            }
+            return;
+        }
+    }
+}
+
+/**
+ * Removes a key. Removal shifts later entries of the probe sequence back, so
+ * the map never accumulates tombstones.
+ *
+ * @param map The map to update.
+ * @param key The key to remove.
+ * @return 1 if the key was present, 0 otherwise.
+ */
+int int_map_remove(struct int_map* map, int key) {
+    unsigned mask = map->capacity - 1;
+    unsigned hole = home_slot(map, key);
+    for (;; hole = (hole + 1) & mask) {
+        if (map->keys[hole] == key) {
+            break;
+        }
+        if (map->keys[hole] == INT_MAP_FREE) {
+            return 0;
+        }
+    }
+
+    // pull back every later entry whose home slot does not lie between the hole and itself
+    for (unsigned i = (hole + 1) & mask; map->keys[i] != INT_MAP_FREE; i = (i + 1) & mask) {
+        unsigned home = home_slot(map, map->keys[i]);
+        if (((i - home) & mask) >= ((i - hole) & mask)) {
+            map->keys[hole] = map->keys[i];
+            map->values[hole] = map->values[i];
+            hole = i;
+        }
+    }
+    map->keys[hole] = INT_MAP_FREE;
+    map->size--;
+    return 1;
+}
+
+/**
+ * Copies all keys into an array.
+ *
+ * @param map The map to read.
+ * @param keys Receives map->size keys, in no particular order.
+ */
+void int_map_keys(const struct int_map* map, int* keys) {
+    unsigned n = 0;
+    for (unsigned i = 0; i < map->capacity; i++) {
+        if (map->keys[i] != INT_MAP_FREE) {
+            keys[n++] = map->keys[i];
+        }
+    }
+}
@@ -0,0 +1,320 @@
+/*
+ * Multi-process simulation over a shared frame pool.
+ *
+ * Processes are numbered densely in order of first appearance, and a flat
+ * int_map translates pids to those indices, so the cost per reference does
+ * not grow with the number of processes. Local replacement gives every
+ * process its own page table with quota frames carved out of the pool.
+ * Global replacement runs one page table over the whole pool, keyed by
+ * index * page_count + page, and an evict hook charges every eviction back
+ * to the process that owned the page. Those keys repeat every page_count, so
+ * the sparse table relies on int_map hashing with the high bits of the
+ * product: page p of every process gets its own home slot, and a reference
+ * costs the same however many processes share the pool.
+ */
+
+#include <limits.h>
+#include "MultiProcess.h"
+#include "IntMap.h"
+
+// number of references translated to global keys at a time
+#define KEY_BATCH_SIZE 1024
+
+struct multi_process {
+    int page_count;
+    int frame_count;
+    enum replacement_algorithm algorithm;
+    enum replacement_scope scope;
+    int quota;
+    // frames not yet given to a process under local replacement
+    int free_frames;
+
+    // pid -> process index
+    struct int_map process_index;
+    struct process_stats *stats;
+    // LOCAL_REPLACEMENT: the page table of every process
+    struct page_table **tables;
+    int process_count;
+    int process_capacity;
+
+    // GLOBAL_REPLACEMENT: the shared page table
+    struct page_table *global;
+    int max_processes;
+};
+
+/**
+ * Evict hook of the global table: the page belonged to process key / page_count.
+ */
+static void charge_eviction(void *context, int key) {
+    struct multi_process *mp = (struct multi_process *) context;
+    (mp->stats[key / mp->page_count].resident)--;
+}
+
+/**
+ * Creates a sparse page table.
+ */
+static struct page_table *create_table(const struct multi_process *mp, int page_count, int frame_count) {
+    struct page_table_config config;
+    page_table_config_init(&config, page_count, frame_count, mp->algorithm);
+    config.backend = SPARSE_TABLE;
+    return page_table_create_config(&config);
+}
+
+/**
+ * Creates a multi-process simulation.
+ *
+ * @param page_count Number of pages of every process.
+ * @param frame_count Size of the shared frame pool.
+ * @param algorithm Page replacement algorithm. OPT is not supported.
+ * @param scope Local or global replacement.
+ * @param quota Frames given to every process under local replacement.
+ * @return A multi_process object, or NULL if the arguments are invalid.
+ */
+struct multi_process *multi_process_create(int page_count, int frame_count, enum replacement_algorithm algorithm,
+                                           enum replacement_scope scope, int quota) {
+    if (algorithm == OPT) {
+        // OPT only counts its faults when flushed, so they cannot be charged to a process
+        printf("OPT cannot be simulated per process\n");
+        return NULL;
+    }
+    if (page_count < 1 || frame_count < 1 || (scope == LOCAL_REPLACEMENT && (quota < 1 || quota > frame_count))) {
+        printf("Invalid multi-process configuration: %d pages, %d frames, quota %d\n",
+               page_count, frame_count, quota);
+        return NULL;
+    }
+    struct multi_process *mp = (struct multi_process *) malloc(sizeof(struct multi_process));
+    mp->page_count = page_count;
+    mp->frame_count = frame_count;
+    mp->algorithm = algorithm;
+    mp->scope = scope;
+    mp->quota = quota;
+    mp->free_frames = frame_count;
+    int_map_init(&(mp->process_index), 64);
+    mp->process_count = 0;
+    mp->process_capacity = 64;
+    mp->stats = (struct process_stats *) malloc(sizeof(struct process_stats) * mp->process_capacity);
+    mp->tables = NULL;
+    mp->global = NULL;
+    // global keys must stay ints
+    mp->max_processes = INT_MAX / page_count;
+    if (scope == LOCAL_REPLACEMENT) {
+        mp->tables = (struct page_table **) malloc(sizeof(struct page_table *) * mp->process_capacity);
+    } else {
+        mp->global = create_table(mp, mp->max_processes * page_count, frame_count);
+        if (!mp->global) {
+            multi_process_destroy(&mp);
+            return NULL;
+        }
+        page_table_set_evict_hook(mp->global, charge_eviction, mp);
+    }
+    return mp;
+}
+
+/**
+ * Destroys a multi-process simulation. Sets outside variable to NULL.
+ *
+ * @param mp A multi_process object.
+ */
+void multi_process_destroy(struct multi_process **mp) {
+    if ((*mp)->tables) {
+        for (int i = 0; i < (*mp)->process_count; i++) {
+            page_table_destroy(&((*mp)->tables[i]));
+        }
+        free((*mp)->tables);
+    }
+    if ((*mp)->global) {
+        page_table_destroy(&((*mp)->global));
+    }
+    int_map_free(&((*mp)->process_index));
+    free((*mp)->stats);
+    free(*mp);
+    *mp = NULL;
+}
+
+/**
+ * Registers a process seen for the first time.
+ * @return its index, or -1 if it does not fit
+ */
+static int add_process(struct multi_process *mp, int pid) {
+    if (mp->scope == LOCAL_REPLACEMENT && mp->free_frames < mp->quota) {
+        printf("The pool of %d frames has no quota of %d left for process %d\n",
+               mp->frame_count, mp->quota, pid);
+        return -1;
+    }
+    if (mp->scope == GLOBAL_REPLACEMENT && mp->process_count == mp->max_processes) {
+        printf("At most %d processes of %d pages fit in a global page table\n",
+               mp->max_processes, mp->page_count);
+        return -1;
+    }
+    if (mp->process_count == mp->process_capacity) {
+        mp->process_capacity *= 2;
+        mp->stats = (struct process_stats *) realloc(mp->stats,
+                                                     sizeof(struct process_stats) * mp->process_capacity);
+        if (mp->tables) {
+            mp->tables = (struct page_table **) realloc(mp->tables,
+                                                        sizeof(struct page_table *) * mp->process_capacity);
+        }
+    }
+    int index = mp->process_count;
+    if (mp->scope == LOCAL_REPLACEMENT) {
+        mp->tables[index] = create_table(mp, mp->page_count, mp->quota);
+        if (!mp->tables[index]) {
+            return -1;
+        }
+        mp->free_frames -= mp->quota;
+    }
+    struct process_stats *stats = &(mp->stats[index]);
+    stats->pid = pid;
+    stats->references = 0;
+    stats->faults = 0;
+    stats->resident = 0;
+    int_map_put(&(mp->process_index), pid, index);
+    (mp->process_count)++;
+    return index;
+}
+
+/**
+ * Replays a run of references by one process.
+ */
+static void access_run(struct multi_process *mp, int index, const int *pages, int n) {
+    struct process_stats *stats = &(mp->stats[index]);
+    stats->references += n;
+    if (mp->scope == LOCAL_REPLACEMENT) {
+        struct page_table *pt = mp->tables[index];
+        long long before = page_table_get_faults(pt);
+        page_table_access_pages(pt, pages, (size_t) n);
+        stats->faults += page_table_get_faults(pt) - before;
+        stats->resident = page_table_resident_count(pt);
+        return;
+    }
+    int keys[KEY_BATCH_SIZE];
+    int base = index * mp->page_count;
+    for (int start = 0; start < n; start += KEY_BATCH_SIZE) {
+        int count = n - start < KEY_BATCH_SIZE ? n - start : KEY_BATCH_SIZE;
+        for (int i = 0; i < count; i++) {
+            keys[i] = base + pages[start + i];
+        }
+        long long before = page_table_get_faults(mp->global);
+        page_table_access_pages(mp->global, keys, (size_t) count);
+        long long faults = page_table_get_faults(mp->global) - before;
+        // every fault brought in a page of this process; evictions were charged by the hook
+        stats->faults += faults;
+        stats->resident += (int) faults;
+    }
+}
+
+/**
+ * Replays references tagged with pids. Runs of references by the same process
+ * go to its page table as one batch.
+ *
+ * @param mp A multi_process object.
+ * @param pids The pid of every reference.
+ * @param pages The pages being accessed.
+ * @param n Number of references.
+ * @return 0 on success, -1 if a new process does not fit in the frame pool.
+ */
+int multi_process_access_pages(struct multi_process *mp, const int *pids, const int *pages, int n) {
+    int i = 0;
+    while (i < n) {
+        int pid = pids[i];
+        int run = i + 1;
+        while (run < n && pids[run] == pid) {
+            run++;
+        }
+        for (int j = i; j < run; j++) {
+            if (pages[j] < 0 || pages[j] >= mp->page_count) {
+                printf("Page %d of process %d is out of range\n", pages[j], pid);
+                return -1;
+            }
+        }
+        int index = int_map_get(&(mp->process_index), pid, -1);
+        if (index < 0 && (index = add_process(mp, pid)) < 0) {
+            return -1;
+        }
+        access_run(mp, index, pages + i, run - i);
+        i = run;
+    }
+    return 0;
+}
+
+/**
+ * Replays a trace, starting at the reader's current position.
+ *
+ * @param reader The trace to replay.
+ * @param mp A multi_process object.
+ * @return 0 on success, -1 on error.
+ */
+int multi_process_simulate_trace(struct trace_reader *reader, struct multi_process *mp) {
+    int pids[TRACE_CHUNK_SIZE];
+    int pages[TRACE_CHUNK_SIZE];
+    int n;
+    while ((n = trace_reader_next_chunk_pids(reader, pids, pages, TRACE_CHUNK_SIZE)) > 0) {
+        if (multi_process_access_pages(mp, pids, pages, n) != 0) {
+            return -1;
+        }
+    }
+    return n;
+}
+
+/**
+ * Returns the number of processes seen so far.
+ *
+ * @param mp A multi_process object.
+ * @return Number of processes.
+ */
+int multi_process_count(const struct multi_process *mp) {
+    return mp->process_count;
+}
+
+/**
+ * Returns the statistics of a process, in order of first appearance.
+ *
+ * @param mp A multi_process object.
+ * @param index Index of the process, below multi_process_count.
+ * @return The statistics of the process.
+ */
+const struct process_stats *multi_process_stats(const struct multi_process *mp, int index) {
+    return &(mp->stats[index]);
+}
+
+/**
+ * qsort comparator ordering process_stats by pid.
+ */
+static int compare_pids(const void *a, const void *b) {
+    int x = ((const struct process_stats *) a)->pid;
+    int y = ((const struct process_stats *) b)->pid;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Prints the references, faults and resident frames of every process, by
+ * pid, followed by the totals.
+ *
+ * @param mp A multi_process object.
+ * @param out The stream to print to.
+ */
+void multi_process_display(const struct multi_process *mp, FILE *out) {
+    struct process_stats *sorted = (struct process_stats *) malloc(
+            sizeof(struct process_stats) * (mp->process_count > 0 ? mp->process_count : 1));
+    for (int i = 0; i < mp->process_count; i++) {
+        sorted[i] = mp->stats[i];
+    }
+    qsort(sorted, (size_t) mp->process_count, sizeof(struct process_stats), compare_pids);
+
+    fprintf(out, "==== %s replacement, %s, %d frames ====\n",
+            mp->scope == LOCAL_REPLACEMENT ? "Local" : "Global", page_table_algorithm_name(mp->algorithm),
+            mp->frame_count);
+    fprintf(out, "%8s %12s %12s %8s\n", "pid", "references", "faults", "resident");
+    long long references = 0;
+    long long faults = 0;
+    long long resident = 0;
+    for (int i = 0; i < mp->process_count; i++) {
+        fprintf(out, "%8d %12lld %12lld %8d\n", sorted[i].pid, sorted[i].references, sorted[i].faults,
+                sorted[i].resident);
+        references += sorted[i].references;
+        faults += sorted[i].faults;
+        resident += sorted[i].resident;
+    }
+    fprintf(out, "%8s %12lld %12lld %8lld\n", "total", references, faults, resident);
+    free(sorted);
+}
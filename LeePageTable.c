@@ -2,75 +2,411 @@
  * Simulates a page table
  */
 
+#include <fcntl.h>
 #include <limits.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include "PageTable.h"
+#include "DataLoader.h"
+#include "IntMap.h"
+#include "CounterScan.h"
+
+#ifdef PRA_STATS
+#include <time.h>
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <x86intrin.h>
+#endif
+#endif
 
 static const int EMPTY = -1;
-static const unsigned int VALID_BIT = 0;
-
-// page table entry
-struct page_table_entry {
-    // the page number
-    int page_number;
-    // the last frame this entry was in
-    int frame_number;
-    // indicates that a page is in memory
-    unsigned int metadata; // if valid bit == 1, it is in memory
+
+// bit positions of the per-page flags
+enum page_flag {
+    VALID_BIT = 0,
+    DIRTY_BIT,
+    REFERENCED_BIT,
+    // read ahead and not referenced since
+    PREFETCHED_BIT,
+    PAGE_FLAG_COUNT
 };
 
-// Used for FIFO page swapping
+// Used for FIFO page swapping; holds frame numbers in the order they were filled
 struct page_queue {
     int front, rear, size;
     unsigned capacity;
-    struct page_table_entry *array;
+    int *array;
+};
+
+// Link in an intrusive list of frames, indexed by frame number
+struct frame_node {
+    int prev, next;
+};
+
+// Intrusive doubly linked list over an array of frame_nodes
+struct frame_list {
+    int head, tail, size;
+};
+
+/*
+ * Frequency buckets used by LFU and MFU. Every bucket holds the frames that have
+ * been accessed exactly count times; non-empty buckets are kept in a list ordered
+ * by ascending count, so the least and most frequently used frames are always at
+ * the ends of that list.
+ */
+struct freq_buckets {
+    // the bucket of every frame, indexed by frame number
+    int *frame_bucket;
+    // access count of every bucket
+    int *count;
+    // frames of every bucket, threaded through the page table's frame_nodes
+    struct frame_list *frames;
+    // buckets ordered by ascending count
+    struct frame_list order;
+    struct frame_node *order_nodes;
+    // stack of unused buckets
+    int *free_buckets;
+    int free_count;
+    int bucket_count;
+};
+
+// CLOCK-Pro node status bits
+enum clock_pro_status {
+    // the page has a short reuse distance; otherwise it is cold
+    HOT_PAGE = 1,
+    // the cold page is in its test period
+    TEST_PAGE = 2,
+    // the page is in memory; non-resident nodes are cold pages kept for their test period
+    RESIDENT_PAGE = 4
+};
+
+/*
+ * CLOCK-Pro state (Jiang, Chen and Zhang, USENIX ATC 2005). Resident pages and
+ * non-resident test pages share one clock, a circular list of nodes swept by
+ * three hands; the head of the clock is just behind the hot hand. Reference
+ * bits are the pages' REFERENCED_BIT, so hits never touch this structure.
+ */
+struct clock_pro {
+    // circular links of the clock
+    struct frame_node *ring;
+    // page and clock_pro_status bits of every node
+    int *node_page;
+    unsigned char *node_status;
+    // stack of unused nodes
+    int *free_nodes;
+    int free_count;
+    int node_count;
+    // node of every page on the clock
+    struct int_map page_node;
+    int hand_hot, hand_cold, hand_test;
+    // resident hot pages, resident cold pages and non-resident test pages
+    int count_hot, count_cold, count_test;
+    // adaptive target for resident cold pages, between 1 and frame_count
+    int cold_target;
+};
+
+/*
+ * Ghost lists: recently evicted pages remembered without a frame, threaded
+ * through their own node pool and found by page through a hash map.
+ */
+struct ghost_lists {
+    struct frame_node *nodes;
+    // page and list of every node
+    int *node_page;
+    unsigned char *node_list;
+    // stack of unused nodes
+    int *free_nodes;
+    int free_count;
+    int capacity;
+    struct int_map page_node;
+    struct frame_list lists[2];
+};
+
+/*
+ * State shared by ARC and 2Q: two resident lists threaded through the page
+ * table's frame_nodes, plus ghost lists of pages evicted from them. ARC keeps
+ * T1/T2 and B1/B2; 2Q keeps A1in/Am and uses ghost list 0 as A1out.
+ */
+struct adaptive_lists {
+    struct frame_list resident[2];
+    // which resident list every frame is on
+    unsigned char *frame_list;
+    struct ghost_lists ghosts;
+    // ARC: target size p of T1. 2Q: Kin, the size of A1in
+    int target;
+    // 2Q: Kout, the size of A1out
+    int ghost_limit;
+};
+
+/*
+ * Belady's OPT. References are buffered until enough of the future is known,
+ * then a backward pass gives every buffered reference the index of the next
+ * reference to the same page, and resident frames sit in a max-heap keyed by
+ * that next use.
+ */
+struct opt_state {
+    // references still to be replayed, 0 lookahead buffers the whole trace
+    int lookahead;
+    int *pending;
+    unsigned char *pending_write;
+    int *next_use;
+    int pending_count;
+    int pending_capacity;
+    // page -> next buffered reference, filled by the backward pass
+    struct int_map next_seen;
+    // max-heap of resident frames by next use
+    int *heap;
+    int *heap_pos;
+    int *key;
+    int heap_size;
+};
+
+/*
+ * One cache-aligned block holding the table and every fixed-size array of it and its
+ * policy, carved out front to back. Only structures that grow while a trace runs (hash
+ * maps, OPT's unbounded buffer, the resident set size series) live on the heap.
+ */
+struct table_arena {
+    unsigned char *base;
+    size_t size;
+    size_t used;
 };
 
+struct policy_ops;
+
 struct page_table {
     /*
-     * Number of pages to keep track of; this also represents the length of the page_table_entry
-     * array
+     * Number of pages to keep track of; this also represents the length of frame_map and
+     * the number of bits in each page bitset
      */
     int page_count;
-    // array of all page table entries
-    struct page_table_entry *entries;
+    // how page table entries are stored
+    enum page_table_backend backend;
+    /*
+     * DENSE_TABLE entries are kept as a structure of arrays: the last frame every page was
+     * in, and one bitset per page_flag. The hit check only reads the VALID_BIT bitset.
+     */
+    int *frame_map;
+    uint64_t *flags[PAGE_FLAG_COUNT];
+    /*
+     * SPARSE_TABLE entries live in a hash map holding only the pages touched so far; the
+     * value packs (frame + 1) << PAGE_FLAG_COUNT with the flag bits, so 0 is an untouched page.
+     */
+    struct int_map sparse;
     // number of frames in "memory"
     int frame_count;
     // array of frames used
     int *frames;
+    // stack of frames that hold no page; the top is at free_frames[free_count - 1]
+    int *free_frames;
+    int free_count;
     // replacement algorithm to use for page swapping
     enum replacement_algorithm algorithm;
-    int faults;
+    long long faults;
     // FIFO queue
     struct page_queue *fifo_queue;
-    // number of times a frame was accessed
-    int *frame_accesses;
+    // LRU recency list threaded through frame_nodes; head is most recently used
+    struct frame_list lru_list;
+    struct frame_node *frame_nodes;
+    // LFU and MFU access count buckets
+    struct freq_buckets *buckets;
+    // next frame the CLOCK and ENHANCED_SECOND_CHANCE hand looks at
+    int clock_hand;
+    // CLOCK_PRO clock
+    struct clock_pro *clock_pro;
+    // ARC and TWO_QUEUE lists
+    struct adaptive_lists *adaptive;
+    // OPT future references and heap
+    struct opt_state *opt;
+    // NFU saturating access counts per frame, AGING shift registers
+    uint32_t *frame_accesses;
+    // AGING referenced flags per frame, counter width and references per tick
+    uint32_t *frame_referenced;
+    int aging_bits;
+    int aging_tick;
+    int aging_countdown;
+    // WORKING_SET and WSCLOCK virtual time, window and last use of every frame
+    long long time;
+    long long ws_window;
+    long long *frame_last_use;
+    // resident set size curve, one sample every sample_interval references
+    struct page_table_sample *series;
+    int series_count;
+    int series_capacity;
+    int sample_interval;
+    // pages read ahead after a sequential fault, and the page whose fault continues the run
+    int readahead;
+    int sequential_page;
+    // dirty pages waiting to be written back, writeback_batch at a time
+    int *writeback;
+    int writeback_count;
+    int writeback_batch;
+    int page_size;
+    // readahead and write-back counters; reads are derived from the faults on request
+    struct page_table_io io;
+    // called with every page that loses its frame
+    void (*evict_hook)(void *context, int page);
+    void *evict_context;
+    // the block the table sits at the start of, freed with the table unless the caller owns it
+    struct table_arena arena;
+    int owns_arena;
+    // restored tables: the snapshot file mapped copy-on-write, the arena inside it
+    void *mapping;
+    size_t mapping_size;
+    // policy operations and the batch loop bound at creation
+    const struct policy_ops *ops;
+    void (*access_pages)(struct page_table *pt, const int *pages, size_t n);
+#ifdef PRA_STATS
+    // counters and histograms; hits and capacity faults are derived on request
+    struct page_table_stats stats;
+#endif
 };
 
 char *replacement_algorithm[] = {
         "FIFO",
         "LRU",
-        "MFU"
+        "MFU",
+        "LFU",
+        "CLOCK",
+        "ESC",
+        "CLOCK-Pro",
+        "ARC",
+        "2Q",
+        "OPT",
+        "NFU",
+        "AGING",
+        "WS",
+        "WSClock"
 };
 
+// Statistics; without PRA_STATS every macro compiles to nothing
+
+#ifdef PRA_STATS
+#if defined(__x86_64__) && defined(__GNUC__)
+#define STATS_CLOCK_UNIT "cycles"
+#else
+#define STATS_CLOCK_UNIT "ns"
+#endif
+
+/**
+ * Reads the cycle counter, or the monotonic clock where there is none.
+ */
+static inline uint64_t stats_clock(void) {
+#if defined(__x86_64__) && defined(__GNUC__)
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000u + (uint64_t) ts.tv_nsec;
+#endif
+}
+
+/**
+ * Adds count events of the given duration to a power-of-two histogram.
+ */
+static inline void stats_record(long long *histogram, uint64_t ticks, long long count) {
+    int bucket = 0;
+    while (ticks >>= 1) {
+        bucket++;
+    }
+    histogram[bucket < PAGE_TABLE_LATENCY_BUCKETS ? bucket : PAGE_TABLE_LATENCY_BUCKETS - 1] += count;
+}
+
+#define STATS_ADD(pt, counter, n) ((pt)->stats.counter += (n))
+#define STATS_START(start) uint64_t start = stats_clock()
+#define STATS_LATENCY(pt, histogram, start, count) \
+    stats_record((pt)->stats.histogram, (stats_clock() - (start)) / (uint64_t) (count), (long long) (count))
+#else
+#define STATS_ADD(pt, counter, n) ((void) 0)
+#define STATS_START(start) ((void) 0)
+#define STATS_LATENCY(pt, histogram, start, count) ((void) 0)
+#endif
+
+// - End of statistics
+
+// Arena functions
+
+// arena allocations are aligned to a cache line
+#define ARENA_ALIGNMENT ((size_t) 64)
+
+/**
+ * Rounds a size up to whole cache lines, the space it takes in an arena.
+ */
+static inline size_t arena_round(size_t bytes) {
+    return (bytes + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1);
+}
+
+/**
+ * Space an array of n elements of the given size takes in an arena.
+ */
+static inline size_t arena_array(size_t size, size_t n) {
+    return arena_round(size * n);
+}
+
+/**
+ * Carves the next cache-aligned piece out of an arena. The arena is sized from
+ * the same arena_array sums, so running out is a bug, not a condition.
+ * @param arena the arena
+ * @param size the size of one element
+ * @param n the number of elements
+ * @return the uninitialized piece
+ */
+static void *arena_alloc(struct table_arena *arena, size_t size, size_t n) {
+    size_t bytes = arena_array(size, n);
+    if (arena->used + bytes > arena->size) {
+        printf("Page table arena of %zu bytes exhausted\n", arena->size);
+        abort();
+    }
+    void *piece = arena->base + arena->used;
+    arena->used += bytes;
+    return piece;
+}
+
+/*
+ * Moves a pointer into an arena that was copied delta bytes away, for
+ * restoring snapshots.
+ */
+#define ARENA_RELOCATE(pointer, delta) ((pointer) = (void *) ((unsigned char *) (pointer) + (delta)))
+
+// - End of arena functions
+
 // Queue functions
 
 /**
- * Function to create a queue of given capacity.
+ * Space a queue of given capacity takes in an arena.
+ */
+size_t queue_size(unsigned capacity) {
+    return arena_array(sizeof(struct page_queue), 1) + arena_array(sizeof(int), capacity);
+}
+
+/**
+ * Empties a queue.
  * It initializes size of queue as 0.
  */
-struct page_queue *create_queue(unsigned capacity) {
-    struct page_queue *queue = (struct page_queue *) malloc(sizeof(struct page_queue));
-    queue->capacity = capacity;
+void queue_clear(struct page_queue *queue) {
     queue->front = queue->size = 0;
-    queue->rear = capacity - 1;  // This is important, see the enqueue
-    queue->array = (struct page_table_entry *) malloc(queue->capacity * sizeof(struct page_table_entry));
+    queue->rear = queue->capacity - 1;  // This is important, see the enqueue
+}
+
+/**
+ * Function to create an empty queue of given capacity in an arena.
+ */
+struct page_queue *create_queue(struct table_arena *arena, unsigned capacity) {
+    struct page_queue *queue = (struct page_queue *) arena_alloc(arena, sizeof(struct page_queue), 1);
+    queue->capacity = capacity;
+    queue->array = (int *) arena_alloc(arena, sizeof(int), capacity);
+    queue_clear(queue);
     return queue;
 }
 
 /**
  * Queue is full when size becomes equal to the capacity
  */
-int is_full(struct page_queue *queue) { return (queue->size == queue->capacity); }
+int is_full(struct page_queue *queue) { return ((unsigned) queue->size == queue->capacity); }
 
 /**
  * Queue is empty when size is 0
@@ -85,7 +421,7 @@ int is_empty(struct page_queue *queue) { return (queue->size == 0); }
  * @param queue the queue to add to
  * @param item the item to add
  */
-void enqueue(struct page_queue *queue, struct page_table_entry item) {
+void enqueue(struct page_queue *queue, int item) {
     if (is_full(queue)) {
         return;
     }
@@ -100,11 +436,11 @@ void enqueue(struct page_queue *queue, struct page_table_entry item) {
  * @param queue the queue to remove from
  * @return the item that was removed
  */
-struct page_table_entry *dequeue(struct page_queue *queue) {
+int dequeue(struct page_queue *queue) {
     if (is_empty(queue)) {
-        return NULL;
+        return EMPTY;
     }
-    struct page_table_entry *item = &(queue->array[queue->front]);
+    int item = queue->array[queue->front];
     queue->front = (queue->front + 1) % queue->capacity;
     queue->size = queue->size - 1;
     return item;
@@ -112,192 +448,2976 @@ struct page_table_entry *dequeue(struct page_queue *queue) {
 
 // - End of queue functions
 
+// Bitset functions
+
 /**
- * Creates a new page table object. Returns a pointer to created page table.
- *
- * @param page_count Number of pages.
- * @param frame_count Numbers of frames.
- * @param algorithm Page replacement algorithm
- * @param verbose Enables showing verbose table contents.
- * @return A page table object.
+ * Returns the number of 64-bit words needed for a bitset of n bits.
  */
-struct page_table *page_table_create(int page_count, int frame_count,
-                                     enum replacement_algorithm algorithm, int verbose) {
-    struct page_table *pt = (struct page_table *) malloc(sizeof(struct page_table));
-    pt->page_count = page_count;
-    pt->algorithm = algorithm;
-    pt->faults = 0;
-    pt->entries = (struct page_table_entry *) malloc(sizeof(struct page_table_entry) * page_count);
-    for (int i = 0; i < page_count; ++i) {
-        pt->entries[i].page_number = i;
-        pt->entries[i].metadata = 0;
-        pt->entries[i].frame_number = EMPTY;
+static size_t bitset_words(int n) {
+    return ((size_t) n + 63) / 64;
+}
+
+/**
+ * Return true if a bit is set.
+ * @param set the bitset to check
+ * @param bit the bit to check
+ * @return true if a bit is set
+ */
+static inline int is_bit_set(const uint64_t *set, int bit) {
+    return (int) ((set[bit >> 6] >> (bit & 63)) & 1u);
+}
+
+static inline void set_bit(uint64_t *set, int bit) {
+    set[bit >> 6] |= UINT64_C(1) << (bit & 63);
+}
+
+static inline void clear_bit(uint64_t *set, int bit) {
+    set[bit >> 6] &= ~(UINT64_C(1) << (bit & 63));
+}
+
+// - End of bitset functions
+
+// Page entry functions, hiding the backend
+
+/**
+ * Tests a flag of a page.
+ * @param pt the page table
+ * @param page the page to check
+ * @param flag the flag to check
+ * @return true if the flag is set
+ */
+static inline int page_test(const struct page_table *pt, int page, enum page_flag flag) {
+    if (pt->backend == DENSE_TABLE) {
+        return is_bit_set(pt->flags[flag], page);
     }
+    return (int_map_get(&(pt->sparse), page, 0) >> flag) & 1;
+}
 
-    pt->frame_count = frame_count;
-    pt->frames = (int *) malloc(sizeof(int) * frame_count);
-    // initialize all frames to EMPTY
-    for (int i = 0; i < frame_count; i++) {
-        pt->frames[i] = EMPTY;
+static inline void page_set(struct page_table *pt, int page, enum page_flag flag) {
+    if (pt->backend == DENSE_TABLE) {
+        set_bit(pt->flags[flag], page);
+    } else {
+        int_map_put(&(pt->sparse), page, int_map_get(&(pt->sparse), page, 0) | (1 << flag));
+    }
+}
+
+static inline void page_clear(struct page_table *pt, int page, enum page_flag flag) {
+    if (pt->backend == DENSE_TABLE) {
+        clear_bit(pt->flags[flag], page);
+    } else {
+        int_map_put(&(pt->sparse), page, int_map_get(&(pt->sparse), page, 0) & ~(1 << flag));
+    }
+}
+
+/**
+ * Returns the last frame a page was in, or EMPTY if it was never loaded.
+ */
+static inline int page_last_frame(const struct page_table *pt, int page) {
+    if (pt->backend == DENSE_TABLE) {
+        return pt->frame_map[page];
+    }
+    return (int_map_get(&(pt->sparse), page, 0) >> PAGE_FLAG_COUNT) - 1;
+}
+
+/**
+ * Returns the frame a page is in, or EMPTY if it is not in memory.
+ */
+static inline int page_resident_frame(const struct page_table *pt, int page) {
+    if (pt->backend == DENSE_TABLE) {
+        return is_bit_set(pt->flags[VALID_BIT], page) ? pt->frame_map[page] : EMPTY;
+    }
+    int entry = int_map_get(&(pt->sparse), page, 0);
+    return (entry & (1 << VALID_BIT)) ? (entry >> PAGE_FLAG_COUNT) - 1 : EMPTY;
+}
+
+/**
+ * Records that a page now lives in a frame: stores the frame number and sets
+ * the VALID and REFERENCED bits.
+ */
+static inline void page_load(struct page_table *pt, int page, int frame) {
+    if (pt->backend == DENSE_TABLE) {
+        pt->frame_map[page] = frame;
+        set_bit(pt->flags[VALID_BIT], page);
+        set_bit(pt->flags[REFERENCED_BIT], page);
+    } else {
+        int_map_put(&(pt->sparse), page, ((frame + 1) << PAGE_FLAG_COUNT) | (1 << VALID_BIT) | (1 << REFERENCED_BIT));
     }
-    if (algorithm == FIFO) {
-        // create a FIFO queue of size frame_count
-        pt->fifo_queue = create_queue(frame_count);
-    } else if (algorithm == LRU) {
-        // create a tracker for how many times a frame has been accessed
-        pt->frame_accesses = (int *) malloc(sizeof(int) * frame_count);
-        // initialize all frame accesses to 0
-        for (int i = 0; i < frame_count; i++) {
-            pt->frame_accesses[i] = 0;
+}
+
+/**
+ * Records that a page left memory; it keeps its last frame number.
+ */
+static inline void page_unload(struct page_table *pt, int page) {
+    if (pt->backend == DENSE_TABLE) {
+        for (int flag = 0; flag < PAGE_FLAG_COUNT; flag++) {
+            clear_bit(pt->flags[flag], page);
         }
+    } else {
+        int entry = int_map_get(&(pt->sparse), page, 0);
+        int_map_put(&(pt->sparse), page, entry & ~((1 << PAGE_FLAG_COUNT) - 1));
     }
-    if (verbose) {
-        printf("Created page_table{page_count=%d, frame_count=%d, replacement_algorithm=%s}\n",
-               pt->page_count, pt->frame_count, replacement_algorithm[algorithm]);
+}
+
+// - End of page entry functions
+
+// Frame list functions
+
+/**
+ * Initializes an empty frame list.
+ * @param list the list to initialize
+ */
+void list_init(struct frame_list *list) {
+    list->head = list->tail = EMPTY;
+    list->size = 0;
+}
+
+/**
+ * Links a frame in at the head of the list.
+ * @param list the list to add to
+ * @param nodes the nodes the list is threaded through
+ * @param frame the frame to add
+ */
+void list_push_front(struct frame_list *list, struct frame_node *nodes, int frame) {
+    nodes[frame].prev = EMPTY;
+    nodes[frame].next = list->head;
+    if (list->head != EMPTY) {
+        nodes[list->head].prev = frame;
+    } else {
+        list->tail = frame;
     }
-    return pt;
+    list->head = frame;
+    list->size++;
 }
 
-void swap_fifo(const struct page_table *pt, int page);
+/**
+ * Unlinks a frame from the list.
+ * @param list the list to remove from
+ * @param nodes the nodes the list is threaded through
+ * @param frame the frame to remove
+ */
+void list_remove(struct frame_list *list, struct frame_node *nodes, int frame) {
+    int prev = nodes[frame].prev;
+    int next = nodes[frame].next;
+    if (prev != EMPTY) {
+        nodes[prev].next = next;
+    } else {
+        list->head = next;
+    }
+    if (next != EMPTY) {
+        nodes[next].prev = prev;
+    } else {
+        list->tail = prev;
+    }
+    list->size--;
+}
 
 /**
- * Place the specified page in memory
- * @param pt the page table
- * @param page the page to place in memory
- * @param frame the frame number to "put" the page in
+ * Moves a frame that is already in the list to its head.
+ * @param list the list to reorder
+ * @param nodes the nodes the list is threaded through
+ * @param frame the frame to move
  */
-void place_in_memory(const struct page_table *pt, int page, int frame) {
-    pt->frames[frame] = page;   // store the page in the used frames array
-    pt->entries[page].frame_number = frame; // store the frame number in the page table entry
-    pt->entries[page].metadata |= 1UL << VALID_BIT; // set the VALID bit
-    if (pt->algorithm == FIFO) {
-        enqueue(pt->fifo_queue, pt->entries[page]);  // put the page in the FIFO queue
-    } else if (pt->algorithm == LRU) {
-        (pt->frame_accesses[frame])++;  // increment the counter of accesses for frame
+void list_move_front(struct frame_list *list, struct frame_node *nodes, int frame) {
+    if (list->head == frame) {
+        return;
     }
+    list_remove(list, nodes, frame);
+    list_push_front(list, nodes, frame);
 }
 
 /**
- * Destorys an existing page table object. Sets outside variable to NULL.
- *
- * @param pt A page table object.
+ * Links a frame in right after another frame of the list.
+ * @param list the list to add to
+ * @param nodes the nodes the list is threaded through
+ * @param after the frame to insert after
+ * @param frame the frame to add
  */
-void page_table_destroy(struct page_table **pt) {
-    free((*pt)->entries);
-    free((*pt)->frames);
-    if ((*pt)->algorithm == FIFO) {
-        free((*pt)->fifo_queue);
-    } else if ((*pt)->algorithm == LRU) {
-        free((*pt)->frame_accesses);
+void list_insert_after(struct frame_list *list, struct frame_node *nodes, int after, int frame) {
+    int next = nodes[after].next;
+    nodes[frame].prev = after;
+    nodes[frame].next = next;
+    nodes[after].next = frame;
+    if (next != EMPTY) {
+        nodes[next].prev = frame;
+    } else {
+        list->tail = frame;
     }
-    free(*pt);
+    list->size++;
 }
 
+// - End of frame list functions
+
+// Frequency bucket functions
+
 /**
- * Return true if a bit is set.
- * @param n number with the bit to check
- * @param bit the bit to check
- * @return true if a bit is set
+ * Space the frequency buckets for frame_count frames take in an arena. There
+ * can never be more non-empty buckets than frames; one spare bucket covers an
+ * increment that acquires its new bucket before releasing the old one.
+ */
+size_t buckets_size(int frame_count) {
+    size_t bucket_count = (size_t) frame_count + 1;
+    return arena_array(sizeof(struct freq_buckets), 1) + arena_array(sizeof(int), frame_count) +
+           arena_array(sizeof(int), bucket_count) + arena_array(sizeof(struct frame_list), bucket_count) +
+           arena_array(sizeof(struct frame_node), bucket_count) + arena_array(sizeof(int), bucket_count);
+}
+
+/**
+ * Returns every bucket to the free stack.
+ * @param fb the buckets to clear
  */
-unsigned is_bit_set(unsigned n, unsigned bit) {
-    return (n & (1ul << bit));
+void buckets_clear(struct freq_buckets *fb) {
+    list_init(&(fb->order));
+    fb->free_count = fb->bucket_count;
+    for (int i = 0; i < fb->bucket_count; i++) {
+        fb->free_buckets[i] = fb->bucket_count - 1 - i;
+    }
 }
 
-unsigned clear_bit(unsigned n, unsigned bit) {
-    return (n & ~(1ul << VALID_BIT));
+/**
+ * Creates empty frequency buckets for a page table in an arena.
+ * @param arena the arena
+ * @param frame_count the number of frames
+ * @return the buckets
+ */
+struct freq_buckets *create_buckets(struct table_arena *arena, int frame_count) {
+    struct freq_buckets *fb = (struct freq_buckets *) arena_alloc(arena, sizeof(struct freq_buckets), 1);
+    fb->bucket_count = frame_count + 1;
+    fb->frame_bucket = (int *) arena_alloc(arena, sizeof(int), frame_count);
+    fb->count = (int *) arena_alloc(arena, sizeof(int), fb->bucket_count);
+    fb->frames = (struct frame_list *) arena_alloc(arena, sizeof(struct frame_list), fb->bucket_count);
+    fb->order_nodes = (struct frame_node *) arena_alloc(arena, sizeof(struct frame_node), fb->bucket_count);
+    fb->free_buckets = (int *) arena_alloc(arena, sizeof(int), fb->bucket_count);
+    buckets_clear(fb);
+    return fb;
 }
 
 /**
- * Swap the page into memory by replacing the oldest page.
- * @param pt the page table
- * @param page the page number
+ * Takes an unused bucket for the given count and links it in after another
+ * bucket, or at the front of the order when after is EMPTY.
+ * @return the new bucket
+ */
+int bucket_acquire(struct freq_buckets *fb, int count, int after) {
+    int bucket = fb->free_buckets[--(fb->free_count)];
+    fb->count[bucket] = count;
+    list_init(&(fb->frames[bucket]));
+    if (after == EMPTY) {
+        list_push_front(&(fb->order), fb->order_nodes, bucket);
+    } else {
+        list_insert_after(&(fb->order), fb->order_nodes, after, bucket);
+    }
+    return bucket;
+}
+
+/**
+ * Unlinks a frame from its bucket, releasing the bucket if it becomes empty.
  */
-void swap_fifo(const struct page_table *pt, int page) {
-    struct page_table_entry *fi_page = dequeue(pt->fifo_queue);
+void bucket_unlink_frame(struct freq_buckets *fb, struct frame_node *nodes, int frame) {
+    int bucket = fb->frame_bucket[frame];
+    list_remove(&(fb->frames[bucket]), nodes, frame);
+    if (fb->frames[bucket].size == 0) {
+        list_remove(&(fb->order), fb->order_nodes, bucket);
+        fb->free_buckets[(fb->free_count)++] = bucket;
+    }
+}
 
-    // retrieve the original page table entry
-    struct page_table_entry dequeued = pt->entries[fi_page->page_number];
-    dequeued.metadata &= ~(1ul << VALID_BIT); // clear the bit
-    pt->entries[fi_page->page_number] = dequeued;   // save into the entries
+/**
+ * Adds a newly filled frame with an access count of one.
+ */
+void bucket_insert_frame(struct freq_buckets *fb, struct frame_node *nodes, int frame) {
+    int bucket = fb->order.head;
+    if (bucket == EMPTY || fb->count[bucket] != 1) {
+        bucket = bucket_acquire(fb, 1, EMPTY);
+    }
+    fb->frame_bucket[frame] = bucket;
+    list_push_front(&(fb->frames[bucket]), nodes, frame);
+}
 
-    place_in_memory(pt, page, fi_page->frame_number);
+/**
+ * Moves a frame to the bucket for its next access count.
+ */
+void bucket_increment_frame(struct freq_buckets *fb, struct frame_node *nodes, int frame) {
+    int bucket = fb->frame_bucket[frame];
+    int count = fb->count[bucket] + 1;
+    int next = fb->order_nodes[bucket].next;
+    if (next == EMPTY || fb->count[next] != count) {
+        next = bucket_acquire(fb, count, bucket);
+    }
+    bucket_unlink_frame(fb, nodes, frame);
+    fb->frame_bucket[frame] = next;
+    list_push_front(&(fb->frames[next]), nodes, frame);
 }
 
 /**
- * Swap the page into memory by replacing the least recently used page.
- * @param pt the page table
- * @param page the page number
+ * Picks the victim frame: the oldest frame of the lowest (LFU) or highest (MFU)
+ * count bucket. Ties are broken in FIFO order.
+ * @param most_frequent nonzero to pick from the highest count bucket
+ * @return the victim frame, already unlinked from its bucket
  */
-void swap_lru(const struct page_table *pt, int page) {
-    int lru_frame = 0;
-    for (int i = 0; i < pt->frame_count; ++i) {
-        if (pt->frame_accesses[i] < pt->frame_accesses[lru_frame]) {
-            lru_frame = i;
-        }
+int bucket_pop_victim(struct freq_buckets *fb, struct frame_node *nodes, int most_frequent) {
+    int bucket = most_frequent ? fb->order.tail : fb->order.head;
+    int frame = fb->frames[bucket].tail;
+    bucket_unlink_frame(fb, nodes, frame);
+    return frame;
+}
+
+// - End of frequency bucket functions
+
+// CLOCK-Pro functions
+
+void evict_frame(struct page_table *pt, int frame);
+void place_in_memory(struct page_table *pt, int page, int frame);
+
+/**
+ * Space the CLOCK-Pro clock for frame_count frames takes in an arena. At most
+ * frame_count resident and frame_count test pages, plus the one being added,
+ * are on the clock at any time.
+ */
+size_t clock_pro_size(int frame_count) {
+    size_t node_count = 2 * (size_t) frame_count + 2;
+    return arena_array(sizeof(struct clock_pro), 1) + arena_array(sizeof(struct frame_node), node_count) +
+           arena_array(sizeof(int), node_count) + arena_array(sizeof(unsigned char), node_count) +
+           arena_array(sizeof(int), node_count);
+}
+
+/**
+ * Takes every page off the clock.
+ * @param cp the clock to clear
+ */
+void clock_pro_clear(struct clock_pro *cp) {
+    for (int i = 0; i < cp->node_count; i++) {
+        cp->free_nodes[i] = cp->node_count - 1 - i;
     }
+    cp->free_count = cp->node_count;
+    int_map_clear(&(cp->page_node));
+    cp->hand_hot = cp->hand_cold = cp->hand_test = EMPTY;
+    cp->count_hot = cp->count_cold = cp->count_test = 0;
+    cp->cold_target = 1;
+}
+
+/**
+ * Creates an empty CLOCK-Pro clock in an arena; only the page map is on the heap.
+ * @param arena the arena
+ * @param frame_count the number of frames
+ * @return the clock
+ */
+struct clock_pro *create_clock_pro(struct table_arena *arena, int frame_count) {
+    struct clock_pro *cp = (struct clock_pro *) arena_alloc(arena, sizeof(struct clock_pro), 1);
+    cp->node_count = 2 * frame_count + 2;
+    cp->ring = (struct frame_node *) arena_alloc(arena, sizeof(struct frame_node), cp->node_count);
+    cp->node_page = (int *) arena_alloc(arena, sizeof(int), cp->node_count);
+    cp->node_status = (unsigned char *) arena_alloc(arena, sizeof(unsigned char), cp->node_count);
+    cp->free_nodes = (int *) arena_alloc(arena, sizeof(int), cp->node_count);
+    int_map_init(&(cp->page_node), (unsigned) cp->node_count);
+    clock_pro_clear(cp);
+    return cp;
+}
 
-    // retrieve the original page table entry
-    int lru_page = pt->frames[lru_frame];
-    struct page_table_entry lru_entry = pt->entries[lru_page];
-    lru_entry.metadata = clear_bit(lru_entry.metadata, VALID_BIT); // clear the bit
-    pt->entries[lru_page] = lru_entry;   // save into the entries
+/**
+ * Frees the heap part of the CLOCK-Pro clock; the rest goes with the arena.
+ * @param cp the clock to free
+ */
+void destroy_clock_pro(struct clock_pro *cp) {
+    int_map_free(&(cp->page_node));
+}
 
-    place_in_memory(pt, page, lru_page);
+/**
+ * Unlinks a node from the clock. Hands resting on it move on to the next node.
+ */
+void clock_pro_detach(struct clock_pro *cp, int node) {
+    int prev = cp->ring[node].prev;
+    int next = cp->ring[node].next;
+    if (next == node) {
+        cp->hand_hot = cp->hand_cold = cp->hand_test = EMPTY;
+        return;
+    }
+    cp->hand_hot = cp->hand_hot == node ? next : cp->hand_hot;
+    cp->hand_cold = cp->hand_cold == node ? next : cp->hand_cold;
+    cp->hand_test = cp->hand_test == node ? next : cp->hand_test;
+    cp->ring[prev].next = next;
+    cp->ring[next].prev = prev;
 }
 
 /**
- * Simulates an instruction accessing a particular page in the page table.
- *
- * @param pt A page table object.
- * @param page The page being accessed.
+ * Links a node in at the head of the clock, just behind the hot hand, so every
+ * hand reaches it last.
  */
-void page_table_access_page(struct page_table *pt, int page) {
-    // if page is already in memory, return
-    struct page_table_entry entry = pt->entries[page];
-    if (entry.frame_number != EMPTY && is_bit_set(entry.metadata, VALID_BIT)) {
-        if (pt->algorithm == LRU) {
-            (pt->frame_accesses[entry.frame_number])++;
-        }
+void clock_pro_attach_head(struct clock_pro *cp, int node) {
+    if (cp->hand_hot == EMPTY) {
+        cp->ring[node].prev = cp->ring[node].next = node;
+        cp->hand_hot = cp->hand_cold = cp->hand_test = node;
         return;
     }
-    // if you reached this point, that means there's a page fault
-    (pt->faults)++;
-    // see if there is a free frame
-    for (int i = 0; i < pt->frame_count; ++i) {
-        if (pt->frames[i] == EMPTY) {
-            place_in_memory(pt, page, i);
+    int next = cp->hand_hot;
+    int prev = cp->ring[next].prev;
+    cp->ring[node].prev = prev;
+    cp->ring[node].next = next;
+    cp->ring[prev].next = node;
+    cp->ring[next].prev = node;
+}
+
+/**
+ * Removes a node from the clock for good.
+ */
+void clock_pro_remove(struct clock_pro *cp, int node) {
+    clock_pro_detach(cp, node);
+    int_map_remove(&(cp->page_node), cp->node_page[node]);
+    cp->free_nodes[(cp->free_count)++] = node;
+}
+
+/**
+ * Ends the test period of a cold page. Running out of the test period without
+ * a re-reference means cold pages need less room, so the cold target shrinks.
+ * A non-resident page has nothing left to track and leaves the clock.
+ * @return 1 if the node was removed
+ */
+int clock_pro_end_test(struct clock_pro *cp, int node) {
+    cp->node_status[node] &= (unsigned char) ~TEST_PAGE;
+    if (cp->cold_target > 1) {
+        cp->cold_target--;
+    }
+    if (!(cp->node_status[node] & RESIDENT_PAGE)) {
+        cp->count_test--;
+        clock_pro_remove(cp, node);
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * Runs the test hand until one non-resident test page has been dropped.
+ */
+void clock_pro_run_hand_test(struct clock_pro *cp) {
+    for (;;) {
+        int node = cp->hand_test;
+        unsigned char status = cp->node_status[node];
+        if (!(status & HOT_PAGE) && (status & TEST_PAGE) && clock_pro_end_test(cp, node)) {
             return;
         }
+        cp->hand_test = cp->ring[cp->hand_test].next;
     }
-    // if you reached this point, there was no empty slot
-    if (pt->algorithm == FIFO) {
-        swap_fifo(pt, page);
-    } else if (pt->algorithm == LRU) {
-        swap_lru(pt, page);
+}
+
+/**
+ * Runs the hot hand until one hot page has been turned cold. Referenced hot
+ * pages lose their reference bit; cold pages the hand passes end their test
+ * period.
+ */
+void clock_pro_run_hand_hot(struct page_table *pt) {
+    struct clock_pro *cp = pt->clock_pro;
+    for (;;) {
+        int node = cp->hand_hot;
+        unsigned char status = cp->node_status[node];
+        if (status & HOT_PAGE) {
+            int page = cp->node_page[node];
+            if (page_test(pt, page, REFERENCED_BIT)) {
+                page_clear(pt, page, REFERENCED_BIT);
+            } else {
+                cp->node_status[node] = RESIDENT_PAGE;
+                cp->count_hot--;
+                cp->count_cold++;
+                cp->hand_hot = cp->ring[node].next;
+                return;
+            }
+        } else if ((status & TEST_PAGE) && clock_pro_end_test(cp, node)) {
+            continue;   // the hand already moved past the removed node
+        }
+        cp->hand_hot = cp->ring[cp->hand_hot].next;
     }
 }
 
 /**
- * Displays page table replacement algorithm, number of page faults, and the
- * current contents of the page table.
- *
- * @param pt A page table object.
+ * Runs the cold hand until one resident cold page has left memory, freeing its
+ * frame. A referenced cold page in its test period turns hot; one outside its
+ * test period starts a new one at the head of the clock. An unreferenced cold
+ * page is evicted and, if still in its test period, stays on the clock as a
+ * non-resident test page.
  */
-void page_table_display(struct page_table *pt) {
-    printf("==== Page Table ====\n");
-    printf("Mode : %s\n", replacement_algorithm[pt->algorithm]);
-    printf("Page Faults : %d\n", pt->faults);
-    page_table_display_contents(pt);
+void clock_pro_run_hand_cold(struct page_table *pt) {
+    struct clock_pro *cp = pt->clock_pro;
+    for (;;) {
+        int node = cp->hand_cold;
+        unsigned char status = cp->node_status[node];
+        STATS_ADD(pt, victim_steps, 1);
+        if ((status & RESIDENT_PAGE) && !(status & HOT_PAGE)) {
+            int page = cp->node_page[node];
+            if (page_test(pt, page, REFERENCED_BIT)) {
+                page_clear(pt, page, REFERENCED_BIT);
+                if (status & TEST_PAGE) {
+                    cp->node_status[node] = HOT_PAGE | RESIDENT_PAGE;
+                    cp->count_cold--;
+                    cp->count_hot++;
+                    cp->hand_cold = cp->ring[node].next;
+                    while (cp->count_hot > pt->frame_count - cp->cold_target) {
+                        clock_pro_run_hand_hot(pt);
+                    }
+                } else {
+                    cp->node_status[node] = TEST_PAGE | RESIDENT_PAGE;
+                    clock_pro_detach(cp, node);
+                    clock_pro_attach_head(cp, node);
+                }
+                continue;
+            }
+
+            int frame = page_resident_frame(pt, page);
+            evict_frame(pt, frame);
+            pt->frames[frame] = EMPTY;
+            pt->free_frames[(pt->free_count)++] = frame;
+            cp->count_cold--;
+            if (status & TEST_PAGE) {
+                cp->node_status[node] = TEST_PAGE;
+                cp->count_test++;
+                cp->hand_cold = cp->ring[node].next;
+                if (cp->count_test > pt->frame_count) {
+                    clock_pro_run_hand_test(cp);
+                }
+            } else {
+                clock_pro_remove(cp, node);
+            }
+            return;
+        }
+        cp->hand_cold = cp->ring[cp->hand_cold].next;
+    }
 }
 
 /**
- * Displays the current contents of the page table.
- *
- * @param pt A page table object.
+ * Handles a CLOCK-Pro page fault: frees a frame with the cold hand if memory is
+ * full, then loads the page at the head of the clock. A page faulting during
+ * its test period comes back hot and grows the cold target; any other page
+ * starts out cold in a new test period.
+ * @param pt the page table
+ * @param page the page number
  */
-void page_table_display_contents(struct page_table *pt) {
-    printf("page frame | dirty valid\n");
-    for (int i = 0; i < pt->page_count; ++i) {
-        printf("%4d %4d | %5d %5d\n", i, pt->entries[i].frame_number, 0, pt->entries[i].metadata);
+void clock_pro_fault(struct page_table *pt, int page) {
+    struct clock_pro *cp = pt->clock_pro;
+    if (pt->free_count == 0) {
+        clock_pro_run_hand_cold(pt);
+    }
+    place_in_memory(pt, page, pt->free_frames[--(pt->free_count)]);
+    page_clear(pt, page, REFERENCED_BIT);
+
+    int node = int_map_get(&(cp->page_node), page, EMPTY);
+    if (node != EMPTY) {
+        // re-referenced during its test period
+        if (cp->cold_target < pt->frame_count) {
+            cp->cold_target++;
+        }
+        cp->count_test--;
+        cp->count_hot++;
+        cp->node_status[node] = HOT_PAGE | RESIDENT_PAGE;
+        clock_pro_detach(cp, node);
+        clock_pro_attach_head(cp, node);
+        while (cp->count_hot > pt->frame_count - cp->cold_target) {
+            clock_pro_run_hand_hot(pt);
+        }
+        return;
+    }
+
+    node = cp->free_nodes[--(cp->free_count)];
+    cp->node_page[node] = page;
+    cp->node_status[node] = TEST_PAGE | RESIDENT_PAGE;
+    int_map_put(&(cp->page_node), page, node);
+    clock_pro_attach_head(cp, node);
+    cp->count_cold++;
+}
+
+// - End of CLOCK-Pro functions
+
+// Ghost list functions
+
+/**
+ * Space ghost lists remembering up to capacity pages take in an arena.
+ */
+size_t ghost_size(int capacity) {
+    return arena_array(sizeof(struct frame_node), capacity) + arena_array(sizeof(int), capacity) +
+           arena_array(sizeof(unsigned char), capacity) + arena_array(sizeof(int), capacity);
+}
+
+/**
+ * Forgets every ghost page.
+ */
+void ghost_clear(struct ghost_lists *g) {
+    for (int i = 0; i < g->capacity; i++) {
+        g->free_nodes[i] = g->capacity - 1 - i;
+    }
+    g->free_count = g->capacity;
+    int_map_clear(&(g->page_node));
+    list_init(&(g->lists[0]));
+    list_init(&(g->lists[1]));
+}
+
+/**
+ * Initializes empty ghost lists able to remember up to capacity pages.
+ */
+void ghost_init(struct ghost_lists *g, struct table_arena *arena, int capacity) {
+    g->capacity = capacity;
+    g->nodes = (struct frame_node *) arena_alloc(arena, sizeof(struct frame_node), capacity);
+    g->node_page = (int *) arena_alloc(arena, sizeof(int), capacity);
+    g->node_list = (unsigned char *) arena_alloc(arena, sizeof(unsigned char), capacity);
+    g->free_nodes = (int *) arena_alloc(arena, sizeof(int), capacity);
+    int_map_init(&(g->page_node), (unsigned) capacity);
+    ghost_clear(g);
+}
+
+void ghost_free(struct ghost_lists *g) {
+    int_map_free(&(g->page_node));
+}
+
+/**
+ * Returns the ghost node of a page, or EMPTY.
+ */
+int ghost_lookup(const struct ghost_lists *g, int page) {
+    return int_map_get(&(g->page_node), page, EMPTY);
+}
+
+/**
+ * Remembers a page at the head of a ghost list.
+ */
+void ghost_push_front(struct ghost_lists *g, int list, int page) {
+    int node = g->free_nodes[--(g->free_count)];
+    g->node_page[node] = page;
+    g->node_list[node] = (unsigned char) list;
+    int_map_put(&(g->page_node), page, node);
+    list_push_front(&(g->lists[list]), g->nodes, node);
+}
+
+/**
+ * Forgets a ghost node.
+ */
+void ghost_remove(struct ghost_lists *g, int node) {
+    list_remove(&(g->lists[g->node_list[node]]), g->nodes, node);
+    int_map_remove(&(g->page_node), g->node_page[node]);
+    g->free_nodes[(g->free_count)++] = node;
+}
+
+/**
+ * Forgets the oldest page of a ghost list.
+ */
+void ghost_pop_back(struct ghost_lists *g, int list) {
+    ghost_remove(g, g->lists[list].tail);
+}
+
+// - End of ghost list functions
+
+// ARC and 2Q functions
+
+/**
+ * Space the lists for ARC or 2Q take in an arena.
+ */
+size_t adaptive_lists_size(int frame_count, int ghost_capacity) {
+    return arena_array(sizeof(struct adaptive_lists), 1) + arena_array(sizeof(unsigned char), frame_count) +
+           ghost_size(ghost_capacity);
+}
+
+/**
+ * Empties the resident and ghost lists. ARC starts with a target of 0; 2Q
+ * sets its own sizes afterwards.
+ */
+void adaptive_lists_clear(struct adaptive_lists *al) {
+    list_init(&(al->resident[0]));
+    list_init(&(al->resident[1]));
+    ghost_clear(&(al->ghosts));
+    al->target = 0;
+    al->ghost_limit = 0;
+}
+
+/**
+ * Creates empty lists for ARC or 2Q in an arena.
+ * @param arena the arena
+ * @param frame_count the number of frames
+ * @param ghost_capacity the most pages the ghost lists can hold at once
+ * @return the lists
+ */
+struct adaptive_lists *create_adaptive_lists(struct table_arena *arena, int frame_count, int ghost_capacity) {
+    struct adaptive_lists *al = (struct adaptive_lists *) arena_alloc(arena, sizeof(struct adaptive_lists), 1);
+    al->frame_list = (unsigned char *) arena_alloc(arena, sizeof(unsigned char), frame_count);
+    ghost_init(&(al->ghosts), arena, ghost_capacity);
+    adaptive_lists_clear(al);
+    return al;
+}
+
+void destroy_adaptive_lists(struct adaptive_lists *al) {
+    ghost_free(&(al->ghosts));
+}
+
+/**
+ * Evicts the tail of a resident list into the free frame stack, remembering
+ * the page at the head of a ghost list unless ghost_list is EMPTY.
+ */
+void adaptive_evict_tail(struct page_table *pt, int list, int ghost_list) {
+    struct adaptive_lists *al = pt->adaptive;
+    int frame = al->resident[list].tail;
+    list_remove(&(al->resident[list]), pt->frame_nodes, frame);
+    if (ghost_list != EMPTY) {
+        ghost_push_front(&(al->ghosts), ghost_list, pt->frames[frame]);
+    }
+    evict_frame(pt, frame);
+    pt->frames[frame] = EMPTY;
+    pt->free_frames[(pt->free_count)++] = frame;
+}
+
+/**
+ * Loads a page into a free frame at the head of a resident list.
+ */
+void adaptive_load(struct page_table *pt, int page, int list) {
+    int frame = pt->free_frames[--(pt->free_count)];
+    place_in_memory(pt, page, frame);
+    pt->adaptive->frame_list[frame] = (unsigned char) list;
+    list_push_front(&(pt->adaptive->resident[list]), pt->frame_nodes, frame);
+}
+
+/**
+ * ARC REPLACE: frees a frame from T1 if T1 is over its target p, from T2
+ * otherwise, and remembers the evicted page in the matching ghost list.
+ * @param in_b2 nonzero if the faulting page was found in B2
+ */
+void arc_replace(struct page_table *pt, int in_b2) {
+    struct adaptive_lists *al = pt->adaptive;
+    int t1 = al->resident[0].size;
+    if (t1 >= 1 && ((in_b2 && t1 == al->target) || t1 > al->target)) {
+        adaptive_evict_tail(pt, 0, 0);
+    } else {
+        adaptive_evict_tail(pt, 1, 1);
+    }
+}
+
+/**
+ * Handles an ARC page fault (Megiddo and Modha, FAST 2003). A hit in ghost
+ * list B1 means T1 was too small and grows the target p; a hit in B2 shrinks
+ * it. Either way the page comes back into T2. Any other page enters T1, after
+ * trimming the ghost lists so that T1 + B1 and the whole directory stay within
+ * frame_count and twice frame_count.
+ * @param pt the page table
+ * @param page the page number
+ */
+void arc_fault(struct page_table *pt, int page) {
+    struct adaptive_lists *al = pt->adaptive;
+    struct ghost_lists *g = &(al->ghosts);
+    int c = pt->frame_count;
+    int node = ghost_lookup(g, page);
+    if (node != EMPTY) {
+        int b1 = g->lists[0].size;
+        int b2 = g->lists[1].size;
+        int in_b2 = g->node_list[node] == 1;
+        if (in_b2) {
+            int delta = b1 / b2 > 1 ? b1 / b2 : 1;
+            al->target = al->target - delta > 0 ? al->target - delta : 0;
+        } else {
+            int delta = b2 / b1 > 1 ? b2 / b1 : 1;
+            al->target = al->target + delta < c ? al->target + delta : c;
+        }
+        ghost_remove(g, node);
+        if (pt->free_count == 0) {
+            arc_replace(pt, in_b2);
+        }
+        adaptive_load(pt, page, 1);
+        return;
+    }
+
+    int t1 = al->resident[0].size;
+    int l1 = t1 + g->lists[0].size;
+    int total = l1 + al->resident[1].size + g->lists[1].size;
+    if (l1 == c) {
+        if (t1 < c) {
+            ghost_pop_back(g, 0);
+            if (pt->free_count == 0) {
+                arc_replace(pt, 0);
+            }
+        } else {
+            adaptive_evict_tail(pt, 0, EMPTY);
+        }
+    } else if (total >= c) {
+        if (total == 2 * c) {
+            ghost_pop_back(g, 1);
+        }
+        if (pt->free_count == 0) {
+            arc_replace(pt, 0);
+        }
+    }
+    adaptive_load(pt, page, 0);
+}
+
+/**
+ * Handles an ARC hit: a page in T2 moves to the head of T2, and a page hit a
+ * second time while in T1 is promoted to T2.
+ */
+static inline void arc_hit(struct page_table *pt, int page, int frame) {
+    (void) page;
+    struct adaptive_lists *al = pt->adaptive;
+    if (al->frame_list[frame] == 1) {
+        list_move_front(&(al->resident[1]), pt->frame_nodes, frame);
+    } else {
+        list_remove(&(al->resident[0]), pt->frame_nodes, frame);
+        al->frame_list[frame] = 1;
+        list_push_front(&(al->resident[1]), pt->frame_nodes, frame);
+    }
+}
+
+/**
+ * Handles a 2Q hit: a page in Am moves to the head of Am, while pages in the
+ * FIFO A1in are left alone.
+ */
+static inline void two_queue_hit(struct page_table *pt, int page, int frame) {
+    (void) page;
+    struct adaptive_lists *al = pt->adaptive;
+    if (al->frame_list[frame] == 1) {
+        list_move_front(&(al->resident[1]), pt->frame_nodes, frame);
+    }
+}
+
+/**
+ * Handles a 2Q page fault (Johnson and Shasha, VLDB 1994). A page remembered
+ * in A1out proved it is reused and goes straight to the LRU list Am; any other
+ * page enters the FIFO A1in. Frames are reclaimed from A1in while it is over
+ * Kin, moving the page to A1out, and from the tail of Am otherwise. A1out is
+ * checked before reclaiming, so trimming A1out cannot forget the faulting page.
+ * @param pt the page table
+ * @param page the page number
+ */
+void two_queue_fault(struct page_table *pt, int page) {
+    struct adaptive_lists *al = pt->adaptive;
+    struct ghost_lists *g = &(al->ghosts);
+    int node = ghost_lookup(g, page);
+    if (node != EMPTY) {
+        ghost_remove(g, node);
+    }
+    if (pt->free_count == 0) {
+        if (al->resident[0].size > al->target || al->resident[1].size == 0) {
+            adaptive_evict_tail(pt, 0, 0);
+            if (g->lists[0].size > al->ghost_limit) {
+                ghost_pop_back(g, 0);
+            }
+        } else {
+            adaptive_evict_tail(pt, 1, EMPTY);
+        }
+    }
+
+    adaptive_load(pt, page, node != EMPTY);
+}
+
+// - End of ARC and 2Q functions
+
+// OPT functions
+
+// next use of a page that is not referenced again within the buffer
+static const int NEVER = INT_MAX;
+
+/**
+ * Space the OPT state for frame_count frames takes in an arena.
+ */
+size_t opt_size(int frame_count) {
+    return arena_array(sizeof(struct opt_state), 1) + 3 * arena_array(sizeof(int), frame_count);
+}
+
+/**
+ * Forgets the buffered references and resident frames; the buffer keeps its
+ * capacity.
+ */
+void opt_clear(struct opt_state *opt) {
+    opt->pending_count = 0;
+    opt->heap_size = 0;
+}
+
+/**
+ * Creates empty OPT state in an arena. The reference buffer, which grows
+ * without a lookahead window, and the next use map are on the heap.
+ * @param arena the arena
+ * @param frame_count the number of frames
+ * @param lookahead how many references ahead to look, 0 for the whole trace
+ * @return the state
+ */
+struct opt_state *create_opt(struct table_arena *arena, int frame_count, int lookahead) {
+    struct opt_state *opt = (struct opt_state *) arena_alloc(arena, sizeof(struct opt_state), 1);
+    opt->lookahead = lookahead;
+    // a window replays its first half once the buffer holds two of them
+    opt->pending_capacity = lookahead > 0 ? 2 * lookahead : 4096;
+    opt->pending = (int *) malloc(sizeof(int) * opt->pending_capacity);
+    opt->pending_write = (unsigned char *) malloc(sizeof(unsigned char) * opt->pending_capacity);
+    opt->next_use = (int *) malloc(sizeof(int) * opt->pending_capacity);
+    int_map_init(&(opt->next_seen), (unsigned) frame_count);
+    opt->heap = (int *) arena_alloc(arena, sizeof(int), frame_count);
+    opt->heap_pos = (int *) arena_alloc(arena, sizeof(int), frame_count);
+    opt->key = (int *) arena_alloc(arena, sizeof(int), frame_count);
+    opt_clear(opt);
+    return opt;
+}
+
+/**
+ * Frees the heap part of the OPT state; the rest goes with the arena.
+ */
+void destroy_opt(struct opt_state *opt) {
+    free(opt->pending);
+    free(opt->pending_write);
+    free(opt->next_use);
+    int_map_free(&(opt->next_seen));
+}
+
+void opt_heap_swap(struct opt_state *opt, int i, int j) {
+    int a = opt->heap[i];
+    int b = opt->heap[j];
+    opt->heap[i] = b;
+    opt->heap[j] = a;
+    opt->heap_pos[b] = i;
+    opt->heap_pos[a] = j;
+}
+
+/**
+ * Moves the frame at heap index i towards the root while its next use is later
+ * than its parent's.
+ */
+void opt_sift_up(struct opt_state *opt, int i) {
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (opt->key[opt->heap[parent]] >= opt->key[opt->heap[i]]) {
+            break;
+        }
+        opt_heap_swap(opt, i, parent);
+        i = parent;
+    }
+}
+
+/**
+ * Moves the frame at heap index i towards the leaves while a child is used
+ * later.
+ */
+void opt_sift_down(struct opt_state *opt, int i) {
+    for (;;) {
+        int largest = i;
+        int left = 2 * i + 1;
+        int right = left + 1;
+        if (left < opt->heap_size && opt->key[opt->heap[left]] > opt->key[opt->heap[largest]]) {
+            largest = left;
+        }
+        if (right < opt->heap_size && opt->key[opt->heap[right]] > opt->key[opt->heap[largest]]) {
+            largest = right;
+        }
+        if (largest == i) {
+            return;
+        }
+        opt_heap_swap(opt, i, largest);
+        i = largest;
+    }
+}
+
+/**
+ * Computes the next use of every buffered reference in one backward pass,
+ * then re-keys the resident frames by their first use in the buffer. Keys are
+ * buffer indices, so they are rebuilt whenever the buffer shifts.
+ */
+void opt_prepare(struct page_table *pt) {
+    struct opt_state *opt = pt->opt;
+    int_map_clear(&(opt->next_seen));
+    for (int i = opt->pending_count - 1; i >= 0; i--) {
+        opt->next_use[i] = int_map_get(&(opt->next_seen), opt->pending[i], NEVER);
+        int_map_put(&(opt->next_seen), opt->pending[i], i);
+    }
+    for (int i = 0; i < opt->heap_size; i++) {
+        int frame = opt->heap[i];
+        opt->key[frame] = int_map_get(&(opt->next_seen), pt->frames[frame], NEVER);
+    }
+    for (int i = opt->heap_size / 2 - 1; i >= 0; i--) {
+        opt_sift_down(opt, i);
+    }
+}
+
+/**
+ * Replays the first count buffered references, evicting the resident page
+ * whose next use is furthest away, and drops them from the buffer.
+ */
+void opt_replay(struct page_table *pt, int count) {
+    struct opt_state *opt = pt->opt;
+    for (int i = 0; i < count; i++) {
+        int page = opt->pending[i];
+        int frame = page_resident_frame(pt, page);
+        if (frame != EMPTY) {
+            // the page is now needed later than before
+            opt->key[frame] = opt->next_use[i];
+            opt_sift_down(opt, opt->heap_pos[frame]);
+            opt_sift_up(opt, opt->heap_pos[frame]);
+        } else {
+            (pt->faults)++;
+            STATS_ADD(pt, cold_faults, page_last_frame(pt, page) == EMPTY);
+            if (pt->free_count > 0) {
+                frame = pt->free_frames[--(pt->free_count)];
+                place_in_memory(pt, page, frame);
+                opt->key[frame] = opt->next_use[i];
+                opt->heap[opt->heap_size] = frame;
+                opt->heap_pos[frame] = opt->heap_size;
+                opt_sift_up(opt, (opt->heap_size)++);
+            } else {
+                // the root is the frame used furthest in the future
+                frame = opt->heap[0];
+                evict_frame(pt, frame);
+                place_in_memory(pt, page, frame);
+                opt->key[frame] = opt->next_use[i];
+                opt_sift_down(opt, 0);
+            }
+        }
+        if (opt->pending_write[i]) {
+            page_set(pt, page, DIRTY_BIT);
+        }
+    }
+    opt->pending_count -= count;
+    memmove(opt->pending, opt->pending + count, sizeof(int) * opt->pending_count);
+    memmove(opt->pending_write, opt->pending_write + count, sizeof(unsigned char) * opt->pending_count);
+}
+
+/**
+ * Buffers a reference for OPT. With a lookahead window the first half of the
+ * buffer is replayed once it is full, so every decision sees at least
+ * lookahead references ahead; otherwise the buffer grows until the table is
+ * flushed.
+ */
+void opt_buffer(struct page_table *pt, int page, int write) {
+    struct opt_state *opt = pt->opt;
+    if (opt->pending_count == opt->pending_capacity) {
+        if (opt->lookahead > 0) {
+            opt_prepare(pt);
+            opt_replay(pt, opt->lookahead);
+        } else {
+            opt->pending_capacity *= 2;
+            opt->pending = (int *) realloc(opt->pending, sizeof(int) * opt->pending_capacity);
+            opt->pending_write = (unsigned char *) realloc(opt->pending_write,
+                                                           sizeof(unsigned char) * opt->pending_capacity);
+            opt->next_use = (int *) realloc(opt->next_use, sizeof(int) * opt->pending_capacity);
+        }
+    }
+    opt->pending[opt->pending_count] = page;
+    opt->pending_write[opt->pending_count] = (unsigned char) write;
+    (opt->pending_count)++;
+}
+
+// - End of OPT functions
+
+/**
+ * Fills in a page table configuration with defaults: a dense table without
+ * verbose output.
+ *
+ * @param config The configuration to initialize.
+ * @param page_count Number of pages.
+ * @param frame_count Numbers of frames.
+ * @param algorithm Page replacement algorithm
+ */
+void page_table_config_init(struct page_table_config *config, int page_count, int frame_count,
+                            enum replacement_algorithm algorithm) {
+    config->page_count = page_count;
+    config->frame_count = frame_count;
+    config->algorithm = algorithm;
+    config->backend = DENSE_TABLE;
+    config->verbose = 0;
+    config->opt_lookahead = 0;
+    config->aging_bits = 8;
+    config->aging_tick = 0;
+    config->ws_window = 0;
+    config->sample_interval = 0;
+    config->readahead = 0;
+    config->writeback_batch = 1;
+    config->page_size = 4096;
+}
+
+/**
+ * Creates a new page table object. Returns a pointer to created page table.
+ *
+ * @param page_count Number of pages.
+ * @param frame_count Numbers of frames.
+ * @param algorithm Page replacement algorithm
+ * @param verbose Enables showing verbose table contents.
+ * @return A page table object, or NULL for a bad configuration.
+ */
+struct page_table *page_table_create(int page_count, int frame_count,
+                                     enum replacement_algorithm algorithm, int verbose) {
+    struct page_table_config config;
+    page_table_config_init(&config, page_count, frame_count, algorithm);
+    config.verbose = verbose;
+    return page_table_create_config(&config);
+}
+
+// Policy operations
+
+/*
+ * A replacement policy, bound to the table once at creation. The core never
+ * branches on the algorithm: a new policy fills in one of these and adds it
+ * to policy_table.
+ */
+struct policy_ops {
+    // bytes of arena the policy state takes for a configuration
+    size_t (*state_size)(const struct page_table_config *config);
+    /*
+     * init carves the policy state out of the arena and empties it, returning -1 for a bad
+     * configuration; reset empties it again in place, and destroy frees whatever it keeps on
+     * the heap
+     */
+    int (*init)(struct page_table *pt, const struct page_table_config *config);
+    void (*reset)(struct page_table *pt);
+    void (*destroy)(struct page_table *pt);
+    // a resident page was referenced again
+    void (*on_hit)(struct page_table *pt, int page, int frame);
+    // a page was just placed in a frame
+    void (*on_place)(struct page_table *pt, int frame);
+    // a page that is not resident was referenced; the fault is already counted
+    void (*on_fault)(struct page_table *pt, int page);
+    // chooses the frame to evict when none is free, for fault_replace
+    int (*pick_victim)(struct page_table *pt);
+    // the batch loops for DENSE_TABLE and SPARSE_TABLE; NULL for the generic loop
+    void (*access_pages[2])(struct page_table *pt, const int *pages, size_t n);
+    // a page is written
+    void (*write_page)(struct page_table *pt, int page);
+    // replays anything the policy is holding back
+    void (*flush)(struct page_table *pt);
+    /*
+     * snapshots: relocate moves the policy's arena pointers after the arena was copied delta
+     * bytes away, NULL if the policy cannot be snapshotted; heap_maps stores the hash maps
+     * the policy keeps on the heap and returns how many there are, at most
+     * POLICY_HEAP_MAPS
+     */
+    void (*relocate)(struct page_table *pt, ptrdiff_t delta);
+    int (*heap_maps)(const struct page_table *pt, struct int_map **maps);
+};
+
+// most hash maps a policy keeps on the heap
+#define POLICY_HEAP_MAPS 1
+
+/**
+ * Place the specified page in memory
+ * @param pt the page table
+ * @param page the page to place in memory
+ * @param frame the frame number to "put" the page in
+ */
+void place_in_memory(struct page_table *pt, int page, int frame) {
+    pt->frames[frame] = page;   // store the page in the used frames array
+    page_load(pt, page, frame); // store the frame number and set the VALID bit
+    pt->ops->on_place(pt, frame);
+}
+
+/**
+ * qsort comparator for ints.
+ */
+static int compare_ints(const void *a, const void *b) {
+    int x = *(const int *) a;
+    int y = *(const int *) b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Writes back the queued dirty pages. Sorted, every run of consecutive pages
+ * is one contiguous write.
+ * @param pt the page table
+ */
+static void write_back_batch(struct page_table *pt) {
+    qsort(pt->writeback, (size_t) pt->writeback_count, sizeof(int), compare_ints);
+    for (int i = 0; i < pt->writeback_count; i++) {
+        pt->io.write_ops += i == 0 || pt->writeback[i] != pt->writeback[i - 1] + 1;
+    }
+    pt->writeback_count = 0;
+}
+
+/**
+ * Queues a dirty page for write-back, writing the batch once it is full. The
+ * write is asynchronous: the page leaves memory or turns clean right away.
+ * @param pt the page table
+ * @param page the dirty page
+ */
+static inline void queue_writeback(struct page_table *pt, int page) {
+    (pt->io.pages_written)++;
+    pt->writeback[(pt->writeback_count)++] = page;
+    if (pt->writeback_count == pt->writeback_batch) {
+        write_back_batch(pt);
+    }
+}
+
+/**
+ * Marks the page held by a frame as no longer in memory, queueing it for
+ * write-back if it is dirty. The page keeps its last frame number.
+ * @param pt the page table
+ * @param frame the frame being evicted
+ */
+void evict_frame(struct page_table *pt, int frame) {
+    STATS_ADD(pt, evictions, 1);
+    STATS_ADD(pt, dirty_writebacks, page_test(pt, pt->frames[frame], DIRTY_BIT));
+    if (page_test(pt, pt->frames[frame], DIRTY_BIT)) {
+        queue_writeback(pt, pt->frames[frame]);
+    }
+    page_unload(pt, pt->frames[frame]); // clear the VALID bit
+    if (pt->evict_hook) {
+        pt->evict_hook(pt->evict_context, pt->frames[frame]);
+    }
+}
+
+static size_t no_state_size(const struct page_table_config *config) {
+    (void) config;
+    return 0;
+}
+
+static void no_reset(struct page_table *pt) {
+    (void) pt;
+}
+
+static void no_destroy(struct page_table *pt) {
+    (void) pt;
+}
+
+static void no_relocate(struct page_table *pt, ptrdiff_t delta) {
+    (void) pt;
+    (void) delta;
+}
+
+static int no_heap_maps(const struct page_table *pt, struct int_map **maps) {
+    (void) pt;
+    (void) maps;
+    return 0;
+}
+
+static inline void no_hit(struct page_table *pt, int page, int frame) {
+    (void) pt;
+    (void) page;
+    (void) frame;
+}
+
+static void no_place(struct page_table *pt, int frame) {
+    (void) pt;
+    (void) frame;
+}
+
+/**
+ * The usual fault: take a free frame, or evict the policy's victim, and place
+ * the page there.
+ * @param pt the page table
+ * @param page the page number
+ */
+static void fault_replace(struct page_table *pt, int page) {
+    int frame;
+    if (pt->free_count > 0) {
+        frame = pt->free_frames[--(pt->free_count)];
+    } else {
+        frame = pt->ops->pick_victim(pt);
+        evict_frame(pt, frame);
+    }
+    place_in_memory(pt, page, frame);
+}
+
+/**
+ * Counts a fault and hands it to the policy.
+ * @param pt the page table
+ * @param page the page number
+ */
+static inline void page_fault(struct page_table *pt, int page) {
+    (pt->faults)++;
+    STATS_ADD(pt, cold_faults, page_last_frame(pt, page) == EMPTY);
+    STATS_START(start);
+    pt->ops->on_fault(pt, page);
+    STATS_LATENCY(pt, fault_latency, start, 1);
+}
+
+/**
+ * Batch loop for any policy, calling on_hit through the ops table.
+ */
+static void generic_access_pages(struct page_table *pt, const int *pages, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        int frame = page_resident_frame(pt, pages[i]);
+        if (frame != EMPTY) {
+            pt->ops->on_hit(pt, pages[i], frame);
+        } else {
+            page_fault(pt, pages[i]);
+        }
+    }
+}
+
+/**
+ * Reads ahead after a fault on a page that continues a sequential run: the
+ * following pages that are not resident go into free frames until readahead
+ * pages were looked at or no frame is free, so readahead never evicts. The
+ * policies with their own lists on a fault admit a page read ahead through
+ * their fault handler; the others get it placed straight into the frame,
+ * which leaves their clocks and virtual time alone. A page read ahead starts
+ * out unreferenced.
+ * @param pt the page table
+ * @param page the page that just faulted
+ */
+static void read_ahead(struct page_table *pt, int page) {
+    int sequential = page == pt->sequential_page;
+    pt->sequential_page = page + 1;
+    if (!sequential) {
+        return;
+    }
+    int last = pt->page_count - 1 - page < pt->readahead ? pt->page_count - 1 : page + pt->readahead;
+    for (int next = page + 1; next <= last && pt->free_count > 0; next++) {
+        if (page_resident_frame(pt, next) != EMPTY) {
+            continue;
+        }
+        if (pt->ops->pick_victim) {
+            place_in_memory(pt, next, pt->free_frames[--(pt->free_count)]);
+        } else {
+            pt->ops->on_fault(pt, next);
+        }
+        page_clear(pt, next, REFERENCED_BIT);
+        page_set(pt, next, PREFETCHED_BIT);
+        (pt->io.readahead_pages)++;
+    }
+}
+
+/**
+ * Batch loop for any policy when reading ahead. A hit on a page read ahead
+ * counts as a readahead hit and carries the sequential run on, so the next
+ * fault after it reads ahead again.
+ */
+static void readahead_access_pages(struct page_table *pt, const int *pages, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        int frame = page_resident_frame(pt, pages[i]);
+        if (frame != EMPTY) {
+            if (page_test(pt, pages[i], PREFETCHED_BIT)) {
+                page_clear(pt, pages[i], PREFETCHED_BIT);
+                (pt->io.readahead_hits)++;
+                pt->sequential_page = pages[i] + 1;
+            }
+            pt->ops->on_hit(pt, pages[i], frame);
+        } else {
+            page_fault(pt, pages[i]);
+            read_ahead(pt, pages[i]);
+        }
+    }
+}
+
+/**
+ * A write is an access followed by setting the DIRTY bit.
+ */
+static void generic_write_page(struct page_table *pt, int page) {
+    pt->access_pages(pt, &page, 1);
+    page_set(pt, page, DIRTY_BIT);
+}
+
+static void no_flush(struct page_table *pt) {
+    (void) pt;
+}
+
+// how many references ahead the dense batch loop prefetches page table entries
+#define PREFETCH_DISTANCE 16
+
+/**
+ * Hints the cache to load the dense page table entry of a page.
+ */
+static inline void prefetch_entry(const struct page_table *pt, int page) {
+#if defined(__GNUC__)
+    __builtin_prefetch(&(pt->flags[VALID_BIT][page >> 6]));
+    __builtin_prefetch(&(pt->frame_map[page]));
+#else
+    (void) pt;
+    (void) page;
+#endif
+}
+
+static inline int dense_resident_frame(const struct page_table *pt, int page) {
+    return is_bit_set(pt->flags[VALID_BIT], page) ? pt->frame_map[page] : EMPTY;
+}
+
+static inline int sparse_resident_frame(const struct page_table *pt, int page) {
+    int entry = int_map_get(&(pt->sparse), page, 0);
+    return (entry & (1 << VALID_BIT)) ? (entry >> PAGE_FLAG_COUNT) - 1 : EMPTY;
+}
+
+/*
+ * Defines <policy>_access_pages_dense and <policy>_access_pages_sparse, batch
+ * loops with the backend lookup and the policy's hit function inlined. The
+ * dense loop prefetches the entry of the reference PREFETCH_DISTANCE ahead.
+ */
+#define DEFINE_ACCESS_PAGES(policy, hit)                                              \
+    static void policy##_access_pages_dense(struct page_table *pt, const int *pages, \
+                                            size_t n) {                               \
+        for (size_t i = 0; i < n; i++) {                                              \
+            if (i + PREFETCH_DISTANCE < n) {                                          \
+                prefetch_entry(pt, pages[i + PREFETCH_DISTANCE]);                     \
+            }                                                                         \
+            int frame = dense_resident_frame(pt, pages[i]);                           \
+            if (frame != EMPTY) {                                                     \
+                hit(pt, pages[i], frame);                                             \
+            } else {                                                                  \
+                page_fault(pt, pages[i]);                                             \
+            }                                                                         \
+        }                                                                             \
+    }                                                                                 \
+    static void policy##_access_pages_sparse(struct page_table *pt, const int *pages,\
+                                             size_t n) {                              \
+        for (size_t i = 0; i < n; i++) {                                              \
+            int frame = sparse_resident_frame(pt, pages[i]);                          \
+            if (frame != EMPTY) {                                                     \
+                hit(pt, pages[i], frame);                                             \
+            } else {                                                                  \
+                page_fault(pt, pages[i]);                                             \
+            }                                                                         \
+        }                                                                             \
+    }
+
+// FIFO
+
+static size_t fifo_state_size(const struct page_table_config *config) {
+    return queue_size((unsigned) config->frame_count);
+}
+
+static int fifo_init(struct page_table *pt, const struct page_table_config *config) {
+    (void) config;
+    // create a FIFO queue of size frame_count
+    pt->fifo_queue = create_queue(&(pt->arena), pt->frame_count);
+    return 0;
+}
+
+static void fifo_reset(struct page_table *pt) {
+    queue_clear(pt->fifo_queue);
+}
+
+static void fifo_relocate(struct page_table *pt, ptrdiff_t delta) {
+    ARENA_RELOCATE(pt->fifo_queue, delta);
+    ARENA_RELOCATE(pt->fifo_queue->array, delta);
+}
+
+static void fifo_place(struct page_table *pt, int frame) {
+    enqueue(pt->fifo_queue, frame);  // put the frame in the FIFO queue
+}
+
+/**
+ * Replaces the oldest page.
+ */
+static int fifo_pick_victim(struct page_table *pt) {
+    return dequeue(pt->fifo_queue);
+}
+
+DEFINE_ACCESS_PAGES(fifo, no_hit)
+
+// LRU
+
+static size_t lru_state_size(const struct page_table_config *config) {
+    return arena_array(sizeof(struct frame_node), config->frame_count);
+}
+
+static void lru_reset(struct page_table *pt) {
+    list_init(&(pt->lru_list));
+}
+
+static int lru_init(struct page_table *pt, const struct page_table_config *config) {
+    (void) config;
+    // create the recency list; frames are linked in as they are filled
+    pt->frame_nodes = (struct frame_node *) arena_alloc(&(pt->arena), sizeof(struct frame_node), pt->frame_count);
+    lru_reset(pt);
+    return 0;
+}
+
+static void lru_relocate(struct page_table *pt, ptrdiff_t delta) {
+    ARENA_RELOCATE(pt->frame_nodes, delta);
+}
+
+static inline void lru_hit(struct page_table *pt, int page, int frame) {
+    (void) page;
+    list_move_front(&(pt->lru_list), pt->frame_nodes, frame);
+}
+
+static void lru_place(struct page_table *pt, int frame) {
+    list_push_front(&(pt->lru_list), pt->frame_nodes, frame);  // newest page is most recently used
+}
+
+/**
+ * Replaces the least recently used page, the tail of the recency list.
+ */
+static int lru_pick_victim(struct page_table *pt) {
+    int lru_frame = pt->lru_list.tail;
+    list_remove(&(pt->lru_list), pt->frame_nodes, lru_frame);
+    return lru_frame;
+}
+
+DEFINE_ACCESS_PAGES(lru, lru_hit)
+
+// MFU and LFU
+
+static size_t frequency_state_size(const struct page_table_config *config) {
+    return arena_array(sizeof(struct frame_node), config->frame_count) + buckets_size(config->frame_count);
+}
+
+static int frequency_init(struct page_table *pt, const struct page_table_config *config) {
+    (void) config;
+    // create the access count buckets; frames join them as they are filled
+    pt->frame_nodes = (struct frame_node *) arena_alloc(&(pt->arena), sizeof(struct frame_node), pt->frame_count);
+    pt->buckets = create_buckets(&(pt->arena), pt->frame_count);
+    return 0;
+}
+
+static void frequency_reset(struct page_table *pt) {
+    buckets_clear(pt->buckets);
+}
+
+static void frequency_relocate(struct page_table *pt, ptrdiff_t delta) {
+    ARENA_RELOCATE(pt->frame_nodes, delta);
+    ARENA_RELOCATE(pt->buckets, delta);
+    ARENA_RELOCATE(pt->buckets->frame_bucket, delta);
+    ARENA_RELOCATE(pt->buckets->count, delta);
+    ARENA_RELOCATE(pt->buckets->frames, delta);
+    ARENA_RELOCATE(pt->buckets->order_nodes, delta);
+    ARENA_RELOCATE(pt->buckets->free_buckets, delta);
+}
+
+static inline void frequency_hit(struct page_table *pt, int page, int frame) {
+    (void) page;
+    bucket_increment_frame(pt->buckets, pt->frame_nodes, frame);
+}
+
+static void frequency_place(struct page_table *pt, int frame) {
+    bucket_insert_frame(pt->buckets, pt->frame_nodes, frame);  // first access of the new page
+}
+
+/**
+ * Replaces the most frequently used page.
+ */
+static int mfu_pick_victim(struct page_table *pt) {
+    return bucket_pop_victim(pt->buckets, pt->frame_nodes, 1);
+}
+
+/**
+ * Replaces the least frequently used page.
+ */
+static int lfu_pick_victim(struct page_table *pt) {
+    return bucket_pop_victim(pt->buckets, pt->frame_nodes, 0);
+}
+
+DEFINE_ACCESS_PAGES(frequency, frequency_hit)
+
+// CLOCK, enhanced second chance and CLOCK-Pro
+
+static void clock_reset(struct page_table *pt) {
+    // the hand sweeps frames in the order the free stack fills them
+    pt->clock_hand = 0;
+}
+
+static int clock_init(struct page_table *pt, const struct page_table_config *config) {
+    (void) config;
+    clock_reset(pt);
+    return 0;
+}
+
+static inline void reference_hit(struct page_table *pt, int page, int frame) {
+    (void) frame;
+    page_set(pt, page, REFERENCED_BIT);
+}
+
+/**
+ * Replaces the first page the clock hand finds with its REFERENCED bit clear.
+ * Referenced pages get a second chance: their bit is cleared and the hand
+ * moves on.
+ */
+static int clock_pick_victim(struct page_table *pt) {
+    int victim_frame = pt->clock_hand;
+    STATS_ADD(pt, victim_steps, 1);
+    while (page_test(pt, pt->frames[victim_frame], REFERENCED_BIT)) {
+        page_clear(pt, pt->frames[victim_frame], REFERENCED_BIT);
+        victim_frame = (victim_frame + 1) % pt->frame_count;
+        STATS_ADD(pt, victim_steps, 1);
+    }
+    pt->clock_hand = (victim_frame + 1) % pt->frame_count;
+    return victim_frame;
+}
+
+/**
+ * Replaces a page with the enhanced second-chance algorithm, which ranks pages
+ * by (REFERENCED, DIRTY) so clean pages are evicted before pages that need a
+ * write-back. The hand first looks for an unreferenced clean page without
+ * touching any bits, then for an unreferenced dirty page while clearing
+ * REFERENCED bits on the way, and repeats until one is found.
+ */
+static int enhanced_second_chance_pick_victim(struct page_table *pt) {
+    int victim_frame = EMPTY;
+    while (victim_frame == EMPTY) {
+        for (int i = 0; i < pt->frame_count && victim_frame == EMPTY; i++) {
+            int frame = (pt->clock_hand + i) % pt->frame_count;
+            int candidate = pt->frames[frame];
+            STATS_ADD(pt, victim_steps, 1);
+            if (!page_test(pt, candidate, REFERENCED_BIT) && !page_test(pt, candidate, DIRTY_BIT)) {
+                victim_frame = frame;
+            }
+        }
+        for (int i = 0; i < pt->frame_count && victim_frame == EMPTY; i++) {
+            int frame = (pt->clock_hand + i) % pt->frame_count;
+            int candidate = pt->frames[frame];
+            STATS_ADD(pt, victim_steps, 1);
+            if (!page_test(pt, candidate, REFERENCED_BIT)) {
+                victim_frame = frame;
+            } else {
+                page_clear(pt, candidate, REFERENCED_BIT);
+            }
+        }
+    }
+    pt->clock_hand = (victim_frame + 1) % pt->frame_count;
+    return victim_frame;
+}
+
+static size_t clock_pro_state_size(const struct page_table_config *config) {
+    return clock_pro_size(config->frame_count);
+}
+
+static int clock_pro_init(struct page_table *pt, const struct page_table_config *config) {
+    (void) config;
+    pt->clock_pro = create_clock_pro(&(pt->arena), pt->frame_count);
+    return 0;
+}
+
+static void clock_pro_reset(struct page_table *pt) {
+    clock_pro_clear(pt->clock_pro);
+}
+
+static void clock_pro_relocate(struct page_table *pt, ptrdiff_t delta) {
+    ARENA_RELOCATE(pt->clock_pro, delta);
+    ARENA_RELOCATE(pt->clock_pro->ring, delta);
+    ARENA_RELOCATE(pt->clock_pro->node_page, delta);
+    ARENA_RELOCATE(pt->clock_pro->node_status, delta);
+    ARENA_RELOCATE(pt->clock_pro->free_nodes, delta);
+}
+
+static int clock_pro_heap_maps(const struct page_table *pt, struct int_map **maps) {
+    maps[0] = &(pt->clock_pro->page_node);
+    return 1;
+}
+
+static void clock_pro_destroy(struct page_table *pt) {
+    destroy_clock_pro(pt->clock_pro);
+}
+
+DEFINE_ACCESS_PAGES(reference, reference_hit)
+
+// ARC and 2Q
+
+// T1 + T2 hold the frames; B1 + B2 never exceed frame_count, plus the page coming back
+static int arc_ghost_capacity(int frame_count) {
+    return frame_count + 1;
+}
+
+// A1in + Am hold the frames; A1out never exceeds Kout, plus the page coming back
+static int two_queue_ghost_capacity(int frame_count) {
+    return frame_count / 2 + 2;
+}
+
+static size_t arc_state_size(const struct page_table_config *config) {
+    return arena_array(sizeof(struct frame_node), config->frame_count) +
+           adaptive_lists_size(config->frame_count, arc_ghost_capacity(config->frame_count));
+}
+
+static size_t two_queue_state_size(const struct page_table_config *config) {
+    return arena_array(sizeof(struct frame_node), config->frame_count) +
+           adaptive_lists_size(config->frame_count, two_queue_ghost_capacity(config->frame_count));
+}
+
+static int arc_init(struct page_table *pt, const struct page_table_config *config) {
+    (void) config;
+    pt->frame_nodes = (struct frame_node *) arena_alloc(&(pt->arena), sizeof(struct frame_node), pt->frame_count);
+    pt->adaptive = create_adaptive_lists(&(pt->arena), pt->frame_count, arc_ghost_capacity(pt->frame_count));
+    return 0;
+}
+
+static void arc_reset(struct page_table *pt) {
+    adaptive_lists_clear(pt->adaptive);
+}
+
+static void two_queue_reset(struct page_table *pt) {
+    int frame_count = pt->frame_count;
+    adaptive_lists_clear(pt->adaptive);
+    // the sizes suggested by Johnson and Shasha: Kin = 25% and Kout = 50% of the frames
+    pt->adaptive->target = frame_count / 4 > 1 ? frame_count / 4 : 1;
+    pt->adaptive->ghost_limit = frame_count / 2 > 1 ? frame_count / 2 : 1;
+}
+
+static int two_queue_init(struct page_table *pt, const struct page_table_config *config) {
+    (void) config;
+    int frame_count = pt->frame_count;
+    pt->frame_nodes = (struct frame_node *) arena_alloc(&(pt->arena), sizeof(struct frame_node), frame_count);
+    pt->adaptive = create_adaptive_lists(&(pt->arena), frame_count, two_queue_ghost_capacity(frame_count));
+    two_queue_reset(pt);
+    return 0;
+}
+
+static void adaptive_destroy(struct page_table *pt) {
+    destroy_adaptive_lists(pt->adaptive);
+}
+
+static void adaptive_relocate(struct page_table *pt, ptrdiff_t delta) {
+    ARENA_RELOCATE(pt->frame_nodes, delta);
+    ARENA_RELOCATE(pt->adaptive, delta);
+    ARENA_RELOCATE(pt->adaptive->frame_list, delta);
+    ARENA_RELOCATE(pt->adaptive->ghosts.nodes, delta);
+    ARENA_RELOCATE(pt->adaptive->ghosts.node_page, delta);
+    ARENA_RELOCATE(pt->adaptive->ghosts.node_list, delta);
+    ARENA_RELOCATE(pt->adaptive->ghosts.free_nodes, delta);
+}
+
+static int adaptive_heap_maps(const struct page_table *pt, struct int_map **maps) {
+    maps[0] = &(pt->adaptive->ghosts.page_node);
+    return 1;
+}
+
+DEFINE_ACCESS_PAGES(arc, arc_hit)
+DEFINE_ACCESS_PAGES(two_queue, two_queue_hit)
+
+// NFU
+
+static size_t nfu_state_size(const struct page_table_config *config) {
+    return arena_array(sizeof(uint32_t), config->frame_count);
+}
+
+static int nfu_init(struct page_table *pt, const struct page_table_config *config) {
+    (void) config;
+    // a frame's counter is set when a page is placed in it
+    pt->frame_accesses = (uint32_t *) arena_alloc(&(pt->arena), sizeof(uint32_t), pt->frame_count);
+    return 0;
+}
+
+static void nfu_relocate(struct page_table *pt, ptrdiff_t delta) {
+    ARENA_RELOCATE(pt->frame_accesses, delta);
+}
+
+static inline void nfu_hit(struct page_table *pt, int page, int frame) {
+    (void) page;
+    counter_increment(&(pt->frame_accesses[frame]));
+}
+
+static void nfu_place(struct page_table *pt, int frame) {
+    pt->frame_accesses[frame] = 1;
+}
+
+/**
+ * Replaces the page with the fewest accesses, scanning the counters with the
+ * vector kernel. Ties go to the lowest frame.
+ */
+static int nfu_pick_victim(struct page_table *pt) {
+    STATS_ADD(pt, victim_steps, pt->frame_count);
+    return (int) counter_argmin(pt->frame_accesses, (size_t) pt->frame_count);
+}
+
+DEFINE_ACCESS_PAGES(nfu, nfu_hit)
+
+// AGING
+
+static size_t aging_state_size(const struct page_table_config *config) {
+    return 2 * arena_array(sizeof(uint32_t), config->frame_count);
+}
+
+static void aging_reset(struct page_table *pt) {
+    memset(pt->frame_referenced, 0, sizeof(uint32_t) * pt->frame_count);
+    pt->aging_countdown = pt->aging_tick;
+}
+
+static void aging_relocate(struct page_table *pt, ptrdiff_t delta) {
+    ARENA_RELOCATE(pt->frame_accesses, delta);
+    ARENA_RELOCATE(pt->frame_referenced, delta);
+}
+
+static int aging_init(struct page_table *pt, const struct page_table_config *config) {
+    if (config->aging_bits != 8 && config->aging_bits != 16 && config->aging_bits != 32) {
+        printf("Aging counters must be 8, 16 or 32 bits, not %d\n", config->aging_bits);
+        return -1;
+    }
+    pt->frame_accesses = (uint32_t *) arena_alloc(&(pt->arena), sizeof(uint32_t), pt->frame_count);
+    pt->frame_referenced = (uint32_t *) arena_alloc(&(pt->arena), sizeof(uint32_t), pt->frame_count);
+    pt->aging_bits = config->aging_bits;
+    pt->aging_tick = config->aging_tick > 0 ? config->aging_tick : pt->frame_count;
+    aging_reset(pt);
+    return 0;
+}
+
+/**
+ * Counts one reference towards the next tick, and on the tick ages every
+ * frame's counter in one vector pass.
+ */
+static inline void aging_count_reference(struct page_table *pt) {
+    if (--(pt->aging_countdown) == 0) {
+        counter_age(pt->frame_accesses, pt->frame_referenced, (size_t) pt->frame_count, pt->aging_bits);
+        pt->aging_countdown = pt->aging_tick;
+    }
+}
+
+static inline void aging_hit(struct page_table *pt, int page, int frame) {
+    (void) page;
+    pt->frame_referenced[frame] = 1;
+    aging_count_reference(pt);
+}
+
+/**
+ * A new page starts as if it was referenced in the last tick.
+ */
+static void aging_place(struct page_table *pt, int frame) {
+    pt->frame_accesses[frame] = 1u << (pt->aging_bits - 1);
+    pt->frame_referenced[frame] = 0;
+}
+
+static void aging_fault(struct page_table *pt, int page) {
+    fault_replace(pt, page);
+    aging_count_reference(pt);
+}
+
+DEFINE_ACCESS_PAGES(aging, aging_hit)
+
+// WORKING_SET and WSCLOCK
+
+static int working_set_clock_init(struct page_table *pt, const struct page_table_config *config) {
+    pt->time = 0;
+    pt->ws_window = config->ws_window > 0 ? config->ws_window : pt->frame_count;
+    pt->frame_last_use = (long long *) arena_alloc(&(pt->arena), sizeof(long long), pt->frame_count);
+    return 0;
+}
+
+/**
+ * Appends a sample of the fault count and resident set size once every
+ * sample_interval references of virtual time.
+ */
+static inline void working_set_sample(struct page_table *pt) {
+    if (pt->sample_interval > 0 && pt->time % pt->sample_interval == 0) {
+        if (pt->series_count == pt->series_capacity) {
+            pt->series_capacity = pt->series_capacity > 0 ? 2 * pt->series_capacity : 64;
+            pt->series = (struct page_table_sample *) realloc(
+                    pt->series, sizeof(struct page_table_sample) * pt->series_capacity);
+        }
+        struct page_table_sample *sample = &(pt->series[(pt->series_count)++]);
+        sample->time = pt->time;
+        sample->faults = pt->faults;
+        sample->resident = pt->frame_count - pt->free_count;
+    }
+}
+
+static size_t working_set_state_size(const struct page_table_config *config) {
+    return lru_state_size(config) + arena_array(sizeof(long long), config->frame_count);
+}
+
+static int working_set_init(struct page_table *pt, const struct page_table_config *config) {
+    lru_init(pt, config);
+    return working_set_clock_init(pt, config);
+}
+
+static void working_set_reset(struct page_table *pt) {
+    lru_reset(pt);
+    pt->time = 0;
+}
+
+static void working_set_relocate(struct page_table *pt, ptrdiff_t delta) {
+    ARENA_RELOCATE(pt->frame_nodes, delta);
+    ARENA_RELOCATE(pt->frame_last_use, delta);
+}
+
+/**
+ * Releases the frames of pages that left the working set, i.e. were last used
+ * ws_window or more references ago. The recency list is ordered by last use,
+ * so they are all at its tail.
+ */
+static inline void working_set_expire(struct page_table *pt) {
+    long long oldest = pt->time - pt->ws_window;
+    while (pt->lru_list.size > 0 && pt->frame_last_use[pt->lru_list.tail] <= oldest) {
+        int frame = pt->lru_list.tail;
+        list_remove(&(pt->lru_list), pt->frame_nodes, frame);
+        evict_frame(pt, frame);
+        pt->frames[frame] = EMPTY;
+        pt->free_frames[(pt->free_count)++] = frame;
+    }
+}
+
+static inline void working_set_hit(struct page_table *pt, int page, int frame) {
+    (void) page;
+    list_move_front(&(pt->lru_list), pt->frame_nodes, frame);
+    pt->frame_last_use[frame] = ++(pt->time);
+    working_set_expire(pt);
+    working_set_sample(pt);
+}
+
+static void working_set_place(struct page_table *pt, int frame) {
+    list_push_front(&(pt->lru_list), pt->frame_nodes, frame);
+    pt->frame_last_use[frame] = pt->time;
+}
+
+/**
+ * Faults the page into a free frame. When the working set is larger than the
+ * frames, the least recently used page goes.
+ */
+static void working_set_fault(struct page_table *pt, int page) {
+    (pt->time)++;
+    fault_replace(pt, page);
+    working_set_expire(pt);
+    working_set_sample(pt);
+}
+
+static inline void wsclock_hit(struct page_table *pt, int page, int frame) {
+    (void) frame;
+    page_set(pt, page, REFERENCED_BIT);
+    (pt->time)++;
+    working_set_sample(pt);
+}
+
+static void wsclock_place(struct page_table *pt, int frame) {
+    pt->frame_last_use[frame] = pt->time;
+}
+
+/**
+ * WSClock (Carr and Hennessy, SOSP 1981). The hand stamps referenced pages
+ * with the current time and clears their bit. The first unreferenced page
+ * older than ws_window that is clean is the victim; old dirty pages are
+ * queued for write-back on the way and turn clean. If a whole sweep
+ * finds no clean old page, the first page written back is taken, or failing
+ * that the least recently used one.
+ */
+static int wsclock_pick_victim(struct page_table *pt) {
+    long long oldest = pt->time - pt->ws_window;
+    int written = EMPTY;
+    int least_recent = EMPTY;
+    for (int i = 0; i < pt->frame_count; i++) {
+        int frame = (pt->clock_hand + i) % pt->frame_count;
+        int page = pt->frames[frame];
+        STATS_ADD(pt, victim_steps, 1);
+        if (page_test(pt, page, REFERENCED_BIT)) {
+            page_clear(pt, page, REFERENCED_BIT);
+            pt->frame_last_use[frame] = pt->time;
+        } else if (pt->frame_last_use[frame] <= oldest) {
+            if (!page_test(pt, page, DIRTY_BIT)) {
+                pt->clock_hand = (frame + 1) % pt->frame_count;
+                return frame;
+            }
+            page_clear(pt, page, DIRTY_BIT);
+            STATS_ADD(pt, dirty_writebacks, 1);
+            queue_writeback(pt, page);
+            if (written == EMPTY) {
+                written = frame;
+            }
+        }
+        if (least_recent == EMPTY || pt->frame_last_use[frame] < pt->frame_last_use[least_recent]) {
+            least_recent = frame;
+        }
+    }
+    int victim_frame = written != EMPTY ? written : least_recent;
+    pt->clock_hand = (victim_frame + 1) % pt->frame_count;
+    return victim_frame;
+}
+
+static size_t wsclock_state_size(const struct page_table_config *config) {
+    return arena_array(sizeof(long long), config->frame_count);
+}
+
+static int wsclock_init(struct page_table *pt, const struct page_table_config *config) {
+    clock_init(pt, config);
+    return working_set_clock_init(pt, config);
+}
+
+static void wsclock_reset(struct page_table *pt) {
+    clock_reset(pt);
+    pt->time = 0;
+}
+
+static void wsclock_relocate(struct page_table *pt, ptrdiff_t delta) {
+    ARENA_RELOCATE(pt->frame_last_use, delta);
+}
+
+static void wsclock_fault(struct page_table *pt, int page) {
+    (pt->time)++;
+    fault_replace(pt, page);
+    working_set_sample(pt);
+}
+
+DEFINE_ACCESS_PAGES(working_set, working_set_hit)
+DEFINE_ACCESS_PAGES(wsclock, wsclock_hit)
+
+// OPT
+
+static size_t opt_state_size(const struct page_table_config *config) {
+    return opt_size(config->frame_count);
+}
+
+static int opt_init(struct page_table *pt, const struct page_table_config *config) {
+    pt->opt = create_opt(&(pt->arena), pt->frame_count, config->opt_lookahead);
+    return 0;
+}
+
+static void opt_reset(struct page_table *pt) {
+    opt_clear(pt->opt);
+}
+
+static void opt_destroy(struct page_table *pt) {
+    destroy_opt(pt->opt);
+}
+
+/**
+ * OPT only buffers references; they are replayed once enough of the future
+ * is known.
+ */
+static void opt_access_pages(struct page_table *pt, const int *pages, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        opt_buffer(pt, pages[i], 0);
+    }
+}
+
+static void opt_write_page(struct page_table *pt, int page) {
+    opt_buffer(pt, page, 1);
+}
+
+static void opt_flush(struct page_table *pt) {
+    if (pt->opt->pending_count > 0) {
+        opt_prepare(pt);
+        opt_replay(pt, pt->opt->pending_count);
+    }
+}
+
+static const struct policy_ops fifo_ops = {
+        fifo_state_size, fifo_init, fifo_reset, no_destroy,
+        no_hit, fifo_place, fault_replace, fifo_pick_victim, {fifo_access_pages_dense, fifo_access_pages_sparse},
+        generic_write_page, no_flush,
+        fifo_relocate, no_heap_maps
+};
+
+static const struct policy_ops lru_ops = {
+        lru_state_size, lru_init, lru_reset, no_destroy,
+        lru_hit, lru_place, fault_replace, lru_pick_victim, {lru_access_pages_dense, lru_access_pages_sparse},
+        generic_write_page, no_flush,
+        lru_relocate, no_heap_maps
+};
+
+static const struct policy_ops mfu_ops = {
+        frequency_state_size, frequency_init, frequency_reset, no_destroy,
+        frequency_hit, frequency_place, fault_replace, mfu_pick_victim,
+        {frequency_access_pages_dense, frequency_access_pages_sparse}, generic_write_page, no_flush,
+        frequency_relocate, no_heap_maps
+};
+
+static const struct policy_ops lfu_ops = {
+        frequency_state_size, frequency_init, frequency_reset, no_destroy,
+        frequency_hit, frequency_place, fault_replace, lfu_pick_victim,
+        {frequency_access_pages_dense, frequency_access_pages_sparse}, generic_write_page, no_flush,
+        frequency_relocate, no_heap_maps
+};
+
+static const struct policy_ops clock_ops = {
+        no_state_size, clock_init, clock_reset, no_destroy,
+        reference_hit, no_place, fault_replace, clock_pick_victim,
+        {reference_access_pages_dense, reference_access_pages_sparse}, generic_write_page, no_flush,
+        no_relocate, no_heap_maps
+};
+
+static const struct policy_ops enhanced_second_chance_ops = {
+        no_state_size, clock_init, clock_reset, no_destroy,
+        reference_hit, no_place, fault_replace, enhanced_second_chance_pick_victim,
+        {reference_access_pages_dense, reference_access_pages_sparse}, generic_write_page, no_flush,
+        no_relocate, no_heap_maps
+};
+
+// CLOCK-Pro, ARC and 2Q run their own hands and lists on a fault
+static const struct policy_ops clock_pro_ops = {
+        clock_pro_state_size, clock_pro_init, clock_pro_reset, clock_pro_destroy,
+        reference_hit, no_place, clock_pro_fault, NULL, {reference_access_pages_dense, reference_access_pages_sparse},
+        generic_write_page, no_flush,
+        clock_pro_relocate, clock_pro_heap_maps
+};
+
+static const struct policy_ops arc_ops = {
+        arc_state_size, arc_init, arc_reset, adaptive_destroy,
+        arc_hit, no_place, arc_fault, NULL, {arc_access_pages_dense, arc_access_pages_sparse}, generic_write_page,
+        no_flush,
+        adaptive_relocate, adaptive_heap_maps
+};
+
+static const struct policy_ops two_queue_ops = {
+        two_queue_state_size, two_queue_init, two_queue_reset, adaptive_destroy,
+        two_queue_hit, no_place, two_queue_fault, NULL, {two_queue_access_pages_dense, two_queue_access_pages_sparse},
+        generic_write_page, no_flush,
+        adaptive_relocate, adaptive_heap_maps
+};
+
+// OPT never sees a hit or fault through the core; it replays its own buffer. Its
+// decisions depend on references it has not replayed yet, so it is not snapshotted
+static const struct policy_ops opt_ops = {
+        opt_state_size, opt_init, opt_reset, opt_destroy,
+        no_hit, no_place, fault_replace, NULL, {opt_access_pages, opt_access_pages}, opt_write_page, opt_flush,
+        NULL, no_heap_maps
+};
+
+static const struct policy_ops nfu_ops = {
+        nfu_state_size, nfu_init, no_reset, no_destroy,
+        nfu_hit, nfu_place, fault_replace, nfu_pick_victim, {nfu_access_pages_dense, nfu_access_pages_sparse},
+        generic_write_page, no_flush,
+        nfu_relocate, no_heap_maps
+};
+
+// AGING replaces the page with the smallest shift register, like NFU
+static const struct policy_ops aging_ops = {
+        aging_state_size, aging_init, aging_reset, no_destroy,
+        aging_hit, aging_place, aging_fault, nfu_pick_victim, {aging_access_pages_dense, aging_access_pages_sparse},
+        generic_write_page, no_flush,
+        aging_relocate, no_heap_maps
+};
+
+static const struct policy_ops working_set_ops = {
+        working_set_state_size, working_set_init, working_set_reset, no_destroy,
+        working_set_hit, working_set_place, working_set_fault, lru_pick_victim,
+        {working_set_access_pages_dense, working_set_access_pages_sparse}, generic_write_page, no_flush,
+        working_set_relocate, no_heap_maps
+};
+
+static const struct policy_ops wsclock_ops = {
+        wsclock_state_size, wsclock_init, wsclock_reset, no_destroy,
+        wsclock_hit, wsclock_place, wsclock_fault, wsclock_pick_victim,
+        {wsclock_access_pages_dense, wsclock_access_pages_sparse}, generic_write_page, no_flush,
+        wsclock_relocate, no_heap_maps
+};
+
+// policies by enum replacement_algorithm
+static const struct policy_ops *const policy_table[] = {
+        [FIFO] = &fifo_ops,
+        [LRU] = &lru_ops,
+        [MFU] = &mfu_ops,
+        [LFU] = &lfu_ops,
+        [CLOCK] = &clock_ops,
+        [ENHANCED_SECOND_CHANCE] = &enhanced_second_chance_ops,
+        [CLOCK_PRO] = &clock_pro_ops,
+        [ARC] = &arc_ops,
+        [TWO_QUEUE] = &two_queue_ops,
+        [OPT] = &opt_ops,
+        [NFU] = &nfu_ops,
+        [AGING] = &aging_ops,
+        [WORKING_SET] = &working_set_ops,
+        [WSCLOCK] = &wsclock_ops
+};
+
+// - End of policy operations
+
+/**
+ * Returns the number of dirty pages a configuration writes back at a time.
+ */
+static int writeback_batch(const struct page_table_config *config) {
+    return config->writeback_batch > 1 ? config->writeback_batch : 1;
+}
+
+/**
+ * Binds the batch loop of a table: the policy's own or the generic one, or
+ * the readahead loop when reading ahead. OPT replays its own buffer and
+ * never reads ahead.
+ */
+static void bind_access_pages(struct page_table *pt) {
+    pt->access_pages = pt->ops->access_pages[pt->backend];
+    if (!pt->access_pages) {
+        pt->access_pages = generic_access_pages;
+    }
+    if (pt->readahead > 0 && pt->algorithm != OPT) {
+        pt->access_pages = readahead_access_pages;
+    }
+}
+
+/**
+ * Returns the size of the arena a table for a configuration takes: the table
+ * itself, the dense page entries, the frame arrays, the write-back queue and
+ * the policy state.
+ */
+static size_t table_arena_size(const struct page_table_config *config, const struct policy_ops *ops) {
+    size_t size = arena_array(sizeof(struct page_table), 1);
+    if (config->backend == DENSE_TABLE) {
+        size += arena_array(sizeof(int), config->page_count) +
+                PAGE_FLAG_COUNT * arena_array(sizeof(uint64_t), bitset_words(config->page_count));
+    }
+    size += 2 * arena_array(sizeof(int), config->frame_count) + arena_array(sizeof(int), writeback_batch(config));
+    return size + ops->state_size(config);
+}
+
+/**
+ * Empties the page entries and frames and zeroes the counters, everything
+ * but the policy state.
+ */
+static void clear_table_storage(struct page_table *pt) {
+    if (pt->backend == DENSE_TABLE) {
+        for (int i = 0; i < pt->page_count; ++i) {
+            pt->frame_map[i] = EMPTY;
+        }
+        for (int flag = 0; flag < PAGE_FLAG_COUNT; flag++) {
+            memset(pt->flags[flag], 0, sizeof(uint64_t) * bitset_words(pt->page_count));
+        }
+    } else {
+        int_map_clear(&(pt->sparse));
+    }
+    // initialize all frames to EMPTY; the stack hands them out lowest first
+    for (int i = 0; i < pt->frame_count; i++) {
+        pt->frames[i] = EMPTY;
+        pt->free_frames[i] = pt->frame_count - 1 - i;
+    }
+    pt->free_count = pt->frame_count;
+    pt->faults = 0;
+    pt->series_count = 0;
+    pt->sequential_page = EMPTY;
+    pt->writeback_count = 0;
+    memset(&(pt->io), 0, sizeof(pt->io));
+#ifdef PRA_STATS
+    memset(&(pt->stats), 0, sizeof(pt->stats));
+#endif
+}
+
+/**
+ * Frees what the table keeps on the heap, everything but the policy state.
+ */
+static void free_table_storage(struct page_table *pt) {
+    if (pt->backend == SPARSE_TABLE) {
+        int_map_free(&(pt->sparse));
+    }
+    free(pt->series);
+}
+
+/**
+ * Returns the size of the single cache-aligned block a page table for a
+ * configuration is created in.
+ *
+ * @param config The configuration of the table.
+ * @return The size in bytes, a multiple of 64, or 0 if the algorithm is unknown
+ * or the page or frame count is below 1.
+ */
+size_t page_table_arena_size(const struct page_table_config *config) {
+    if ((unsigned) config->algorithm >= sizeof(policy_table) / sizeof(policy_table[0]) ||
+        config->page_count < 1 || config->frame_count < 1) {
+        return 0;
+    }
+    return table_arena_size(config, policy_table[config->algorithm]);
+}
+
+/**
+ * Says why page_table_arena_size rejected a configuration.
+ */
+static void print_config_error(const struct page_table_config *config) {
+    if ((unsigned) config->algorithm >= sizeof(policy_table) / sizeof(policy_table[0])) {
+        printf("Unknown replacement algorithm %d\n", (int) config->algorithm);
+    } else {
+        printf("Invalid page table of %d pages and %d frames\n", config->page_count, config->frame_count);
+    }
+}
+
+/**
+ * Creates a new page table object from a configuration in memory the caller
+ * owns and keeps alive until the table is destroyed.
+ *
+ * @param config The configuration of the table.
+ * @param memory A 64-byte aligned block.
+ * @param size The size of the block, at least page_table_arena_size(config).
+ * @return A page table object at the start of memory, or NULL for an unknown
+ * algorithm, a bad configuration or a block that does not fit.
+ */
+struct page_table *page_table_create_in(const struct page_table_config *config, void *memory, size_t size) {
+    int page_count = config->page_count;
+    int frame_count = config->frame_count;
+    enum replacement_algorithm algorithm = config->algorithm;
+    size_t arena_size = page_table_arena_size(config);
+    if (arena_size == 0) {
+        print_config_error(config);
+        return NULL;
+    }
+    if (!memory || (uintptr_t) memory % ARENA_ALIGNMENT != 0 || size < arena_size) {
+        printf("A page table needs a 64-byte aligned block of %zu bytes\n", arena_size);
+        return NULL;
+    }
+    struct table_arena arena = {(unsigned char *) memory, arena_size, 0};
+    struct page_table *pt = (struct page_table *) arena_alloc(&arena, sizeof(struct page_table), 1);
+    pt->arena = arena;
+    pt->owns_arena = 0;
+    pt->mapping = NULL;
+    pt->mapping_size = 0;
+    pt->page_count = page_count;
+    pt->algorithm = algorithm;
+    pt->backend = config->backend;
+    if (pt->backend == DENSE_TABLE) {
+        pt->frame_map = (int *) arena_alloc(&(pt->arena), sizeof(int), page_count);
+        for (int flag = 0; flag < PAGE_FLAG_COUNT; flag++) {
+            pt->flags[flag] = (uint64_t *) arena_alloc(&(pt->arena), sizeof(uint64_t), bitset_words(page_count));
+        }
+    } else {
+        // only touched pages get an entry; start out sized for the resident set
+        int_map_init(&(pt->sparse), (unsigned) frame_count);
+    }
+
+    pt->frame_count = frame_count;
+    pt->frames = (int *) arena_alloc(&(pt->arena), sizeof(int), frame_count);
+    pt->free_frames = (int *) arena_alloc(&(pt->arena), sizeof(int), frame_count);
+    pt->readahead = config->readahead > 0 ? config->readahead : 0;
+    pt->writeback_batch = writeback_batch(config);
+    pt->writeback = (int *) arena_alloc(&(pt->arena), sizeof(int), pt->writeback_batch);
+    pt->page_size = config->page_size;
+    // policies that keep virtual time append to the series
+    pt->sample_interval = config->sample_interval;
+    pt->series = NULL;
+    pt->series_capacity = 0;
+    pt->evict_hook = NULL;
+    pt->evict_context = NULL;
+    clear_table_storage(pt);
+    pt->ops = policy_table[algorithm];
+    bind_access_pages(pt);
+    if (pt->ops->init(pt, config) != 0) {
+        free_table_storage(pt);
+        return NULL;
+    }
+    if (config->verbose) {
+        printf("Created page_table{page_count=%d, frame_count=%d, replacement_algorithm=%s%s}\n",
+               pt->page_count, pt->frame_count, replacement_algorithm[algorithm],
+               pt->backend == SPARSE_TABLE ? ", sparse" : "");
+    }
+    return pt;
+}
+
+/**
+ * Creates a new page table object from a configuration. The table and all
+ * of its fixed-size state share one cache-aligned allocation.
+ *
+ * @param config The configuration of the table.
+ * @return A page table object, or NULL for an unknown algorithm or a page or
+ * frame count below 1.
+ */
+struct page_table *page_table_create_config(const struct page_table_config *config) {
+    size_t size = page_table_arena_size(config);
+    if (size == 0) {
+        print_config_error(config);
+        return NULL;
+    }
+    void *memory = aligned_alloc(ARENA_ALIGNMENT, size);
+    struct page_table *pt = page_table_create_in(config, memory, size);
+    if (!pt) {
+        free(memory);
+        return NULL;
+    }
+    pt->owns_arena = 1;
+    return pt;
+}
+
+/**
+ * Empties a page table for another run with the same configuration, as if it
+ * was just created, without allocating or freeing memory. The eviction hook
+ * stays installed.
+ *
+ * @param pt A page table object.
+ */
+void page_table_reset(struct page_table *pt) {
+    clear_table_storage(pt);
+    pt->ops->reset(pt);
+}
+
+/**
+ * Destorys an existing page table object. Sets outside variable to NULL.
+ *
+ * @param pt A page table object.
+ */
+void page_table_destroy(struct page_table **pt) {
+    (*pt)->ops->destroy(*pt);
+    free_table_storage(*pt);
+    // a restored table lives inside its mapping
+    void *mapping = (*pt)->mapping;
+    size_t mapping_size = (*pt)->mapping_size;
+    if ((*pt)->owns_arena) {
+        free(*pt);
+    }
+    if (mapping) {
+        munmap(mapping, mapping_size);
+    }
+    *pt = NULL;
+}
+
+// Snapshots
+
+static const char SNAPSHOT_MAGIC[4] = {'P', 'R', 'A', 'S'};
+static const uint32_t SNAPSHOT_VERSION = 2;
+static const uint32_t SNAPSHOT_BYTE_ORDER = 0x01020304;
+
+// the arena starts on its own page, so a mapped snapshot can be used in place
+#define SNAPSHOT_ARENA_OFFSET 4096
+
+/*
+ * First page of a snapshot file, in native byte order. The arena follows as it was in
+ * memory, then every heap map as its capacity, size, keys and values, then the resident
+ * set size series as its length and samples.
+ */
+struct snapshot_header {
+    char magic[4];
+    uint32_t version;
+    // together with table_size, tells whether this build can restore the snapshot
+    uint32_t byte_order;
+    uint32_t table_size;
+    uint64_t arena_size;
+    // trace_mark of the reader the table was replaying, position -1 for none
+    int64_t trace_position;
+    int64_t trace_offset;
+    int32_t trace_skip;
+    uint32_t reserved;
+};
+
+/**
+ * Collects the hash maps the table and its policy keep on the heap.
+ * @param maps receives the maps
+ * @return number of maps
+ */
+static int table_heap_maps(const struct page_table *pt, struct int_map **maps) {
+    int count = 0;
+    if (pt->backend == SPARSE_TABLE) {
+        maps[count++] = (struct int_map *) &(pt->sparse);
+    }
+    return count + pt->ops->heap_maps(pt, maps + count);
+}
+
+static int write_heap_map(const struct int_map *map, FILE *out) {
+    uint32_t counts[2] = {map->capacity, map->size};
+    return fwrite(counts, sizeof(counts), 1, out) == 1 &&
+           fwrite(map->keys, sizeof(int), map->capacity, out) == map->capacity &&
+           fwrite(map->values, sizeof(int), map->capacity, out) == map->capacity ? 0 : -1;
+}
+
+/**
+ * Copies a heap map out of a mapped snapshot.
+ * @param p the map in the snapshot; advanced past it
+ * @param end the end of the snapshot
+ * @return 0 on success, -1 if the snapshot is truncated or corrupt
+ */
+static int read_heap_map(struct int_map *map, const unsigned char **p, const unsigned char *end) {
+    uint32_t counts[2];
+    if ((size_t) (end - *p) < sizeof(counts)) {
+        return -1;
+    }
+    memcpy(counts, *p, sizeof(counts));
+    size_t bytes = sizeof(int) * (size_t) counts[0];
+    if (counts[0] < 2 || (counts[0] & (counts[0] - 1)) != 0 || counts[1] > counts[0] ||
+        (size_t) (end - *p) - sizeof(counts) < 2 * bytes) {
+        return -1;
+    }
+    *p += sizeof(counts);
+    map->keys = (int *) malloc(bytes);
+    map->values = (int *) malloc(bytes);
+    memcpy(map->keys, *p, bytes);
+    memcpy(map->values, *p + bytes, bytes);
+    map->capacity = counts[0];
+    map->shift = 32;
+    for (uint32_t c = counts[0]; c > 1; c >>= 1) {
+        map->shift--;
+    }
+    map->size = counts[1];
+    *p += 2 * bytes;
+    return 0;
+}
+
+/**
+ * Writes the complete state of a page table to a file: page entries, frames,
+ * policy structures, the fault count, statistics and the resident set size
+ * series, with the position of the trace being replayed. Snapshots are raw
+ * memory images and only restore on the build that wrote them.
+ *
+ * @param pt A page table object.
+ * @param mark Where the trace replaying into the table is, or NULL for none.
+ * @param filename The snapshot file to write.
+ * @return 0 on success, -1 for an OPT table or on error.
+ */
+int page_table_snapshot(const struct page_table *pt, const struct trace_mark *mark, char *filename) {
+    if (!pt->ops->relocate) {
+        printf("%s tables cannot be snapshotted\n", replacement_algorithm[pt->algorithm]);
+        return -1;
+    }
+    FILE *out = fopen(filename, "wb");
+    if (!out) {
+        printf("Cannot open file %s\n", filename);
+        return -1;
+    }
+    unsigned char first_page[SNAPSHOT_ARENA_OFFSET] = {0};
+    struct snapshot_header header = {{0}, SNAPSHOT_VERSION, SNAPSHOT_BYTE_ORDER, sizeof(struct page_table),
+                                     pt->arena.size, mark ? mark->position : -1, mark ? mark->offset : -1,
+                                     mark ? mark->skip : 0, 0};
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    memcpy(first_page, &header, sizeof(header));
+    int status = fwrite(first_page, sizeof(first_page), 1, out) == 1 &&
+                 fwrite(pt->arena.base, 1, pt->arena.size, out) == pt->arena.size ? 0 : -1;
+
+    struct int_map *maps[POLICY_HEAP_MAPS + 1];
+    int map_count = table_heap_maps(pt, maps);
+    for (int i = 0; i < map_count && status == 0; i++) {
+        status = write_heap_map(maps[i], out);
+    }
+    uint32_t series_count = (uint32_t) pt->series_count;
+    if (status == 0 && (fwrite(&series_count, sizeof(series_count), 1, out) != 1 ||
+                        (series_count > 0 &&
+                         fwrite(pt->series, sizeof(struct page_table_sample), series_count, out) != series_count))) {
+        status = -1;
+    }
+    if (fclose(out) != 0) {
+        status = -1;
+    }
+    if (status != 0) {
+        printf("Cannot write snapshot %s\n", filename);
+    }
+    return status;
+}
+
+/**
+ * Restores a page table from a snapshot written by the same build. The file
+ * is mapped copy-on-write and the table works in place inside the mapping,
+ * so untouched page entries are only read from disk when first used. The
+ * eviction hook is not restored.
+ *
+ * @param filename The snapshot file.
+ * @param mark Receives where the trace replaying into the table was, position
+ * -1 if the snapshot was not taken mid-trace, or NULL.
+ * @return A page table object, or NULL if the snapshot cannot be restored.
+ */
+struct page_table *page_table_restore(char *filename, struct trace_mark *mark) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        printf("Cannot open file %s\n", filename);
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t) st.st_size < SNAPSHOT_ARENA_OFFSET) {
+        printf("Snapshot %s is truncated\n", filename);
+        close(fd);
+        return NULL;
+    }
+    size_t size = (size_t) st.st_size;
+    void *mapping = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        printf("Cannot map file %s\n", filename);
+        return NULL;
+    }
+
+    struct snapshot_header header;
+    memcpy(&header, mapping, sizeof(header));
+    if (memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0 || header.version != SNAPSHOT_VERSION) {
+        printf("File %s is not a page table snapshot\n", filename);
+        munmap(mapping, size);
+        return NULL;
+    }
+    if (header.byte_order != SNAPSHOT_BYTE_ORDER || header.table_size != sizeof(struct page_table)) {
+        printf("Snapshot %s was written by a different build\n", filename);
+        munmap(mapping, size);
+        return NULL;
+    }
+    struct page_table *pt = (struct page_table *) ((unsigned char *) mapping + SNAPSHOT_ARENA_OFFSET);
+    if (header.arena_size < sizeof(struct page_table) || header.arena_size > size - SNAPSHOT_ARENA_OFFSET ||
+        pt->arena.size != header.arena_size ||
+        (unsigned) pt->algorithm >= sizeof(policy_table) / sizeof(policy_table[0]) ||
+        !policy_table[pt->algorithm]->relocate || (pt->backend != DENSE_TABLE && pt->backend != SPARSE_TABLE)) {
+        printf("Snapshot %s is corrupt\n", filename);
+        munmap(mapping, size);
+        return NULL;
+    }
+
+    // the arena was written as it was in memory; move its pointers to the mapping
+    ptrdiff_t delta = (unsigned char *) pt - pt->arena.base;
+    pt->arena.base = (unsigned char *) pt;
+    if (pt->backend == DENSE_TABLE) {
+        ARENA_RELOCATE(pt->frame_map, delta);
+        for (int flag = 0; flag < PAGE_FLAG_COUNT; flag++) {
+            ARENA_RELOCATE(pt->flags[flag], delta);
+        }
+    }
+    ARENA_RELOCATE(pt->frames, delta);
+    ARENA_RELOCATE(pt->free_frames, delta);
+    pt->ops = policy_table[pt->algorithm];
+    pt->ops->relocate(pt, delta);
+    ARENA_RELOCATE(pt->writeback, delta);
+    bind_access_pages(pt);
+    pt->owns_arena = 0;
+    pt->mapping = mapping;
+    pt->mapping_size = size;
+    pt->evict_hook = NULL;
+    pt->evict_context = NULL;
+
+    // copy the heap parts out, so every pointer the table frees is its own
+    struct int_map *maps[POLICY_HEAP_MAPS + 1];
+    int map_count = table_heap_maps(pt, maps);
+    for (int i = 0; i < map_count; i++) {
+        maps[i]->keys = maps[i]->values = NULL;
+    }
+    pt->series = NULL;
+    pt->series_count = pt->series_capacity = 0;
+    const unsigned char *p = (const unsigned char *) pt + header.arena_size;
+    const unsigned char *end = (const unsigned char *) mapping + size;
+    int status = 0;
+    for (int i = 0; i < map_count && status == 0; i++) {
+        status = read_heap_map(maps[i], &p, end);
+    }
+    uint32_t series_count = 0;
+    if (status == 0 && (size_t) (end - p) >= sizeof(series_count)) {
+        memcpy(&series_count, p, sizeof(series_count));
+        p += sizeof(series_count);
+        if ((size_t) (end - p) / sizeof(struct page_table_sample) < series_count) {
+            status = -1;
+        } else if (series_count > 0) {
+            pt->series = (struct page_table_sample *) malloc(sizeof(struct page_table_sample) * series_count);
+            memcpy(pt->series, p, sizeof(struct page_table_sample) * series_count);
+            pt->series_count = pt->series_capacity = (int) series_count;
+        }
+    } else {
+        status = -1;
+    }
+    if (status != 0) {
+        printf("Snapshot %s is truncated\n", filename);
+        page_table_destroy(&pt);
+        return NULL;
+    }
+    if (mark) {
+        mark->position = header.trace_position;
+        mark->offset = header.trace_offset;
+        mark->skip = header.trace_skip;
+    }
+    return pt;
+}
+
+/**
+ * Starts a what-if run from a warmed-up table: creates a table for another
+ * configuration, typically another policy, holding the same resident pages
+ * with the same dirty bits, fault count and I/O, pending write-backs
+ * included. The resident pages are replayed into the new policy in frame
+ * order, so it starts from the same memory contents but builds its own
+ * history of them.
+ *
+ * @param pt A page table object to fork from; it is not changed.
+ * @param config The configuration of the new table, with the same page and
+ * frame counts as pt.
+ * @return A page table object, or NULL if the configuration does not fit.
+ */
+struct page_table *page_table_fork(const struct page_table *pt, const struct page_table_config *config) {
+    if (config->page_count != pt->page_count || config->frame_count != pt->frame_count) {
+        printf("A fork needs the page and frame counts of the table it starts from\n");
+        return NULL;
+    }
+    struct page_table *fork = page_table_create_config(config);
+    if (!fork) {
+        return NULL;
+    }
+    // the replay loads exactly the resident pages, without reading ahead
+    int readahead = fork->readahead;
+    fork->readahead = 0;
+    for (int frame = 0; frame < pt->frame_count; frame++) {
+        int page = pt->frames[frame];
+        if (page != EMPTY && page_resident_frame(pt, page) == frame) {
+            fork->access_pages(fork, &page, 1);
+        }
+    }
+    fork->ops->flush(fork);
+    fork->readahead = readahead;
+    for (int frame = 0; frame < pt->frame_count; frame++) {
+        int page = pt->frames[frame];
+        if (page != EMPTY && page_test(pt, page, DIRTY_BIT) && page_resident_frame(fork, page) != EMPTY) {
+            page_set(fork, page, DIRTY_BIT);
+        }
+    }
+    // the warm-up replay is the source's history, not the fork's
+    fork->faults = pt->faults;
+    fork->io = pt->io;
+    // the pages still queued for write-back are already in pages_written
+    fork->writeback_count = 0;
+    for (int i = 0; i < pt->writeback_count; i++) {
+        fork->writeback[(fork->writeback_count)++] = pt->writeback[i];
+        if (fork->writeback_count == fork->writeback_batch) {
+            write_back_batch(fork);
+        }
+    }
+    fork->sequential_page = pt->sequential_page;
+    fork->series_count = 0;
+#ifdef PRA_STATS
+    fork->stats = pt->stats;
+#endif
+    return fork;
+}
+
+// - End of snapshots
+
+/**
+ * Simulates an instruction accessing a particular page in the page table.
+ *
+ * @param pt A page table object.
+ * @param page The page being accessed.
+ */
+void page_table_access_page(struct page_table *pt, int page) {
+    STATS_START(start);
+    pt->access_pages(pt, &page, 1);
+    STATS_ADD(pt, references, 1);
+    STATS_LATENCY(pt, access_latency, start, 1);
+}
+
+/**
+ * Simulates a run of instructions accessing pages, with the same result as
+ * calling page_table_access_page for each of them. The batch runs the loop
+ * specialized for the table's policy and backend; dense tables prefetch the
+ * entries of upcoming references.
+ *
+ * @param pt A page table object.
+ * @param pages The pages being accessed.
+ * @param n Number of pages.
+ */
+void page_table_access_pages(struct page_table *pt, const int *pages, size_t n) {
+    STATS_START(start);
+    pt->access_pages(pt, pages, n);
+    if (n > 0) {
+        STATS_ADD(pt, references, (long long) n);
+        STATS_LATENCY(pt, access_latency, start, n);
+    }
+}
+
+/**
+ * Simulates an instruction writing to a particular page: the page is accessed
+ * and its DIRTY bit is set.
+ *
+ * @param pt A page table object.
+ * @param page The page being written.
+ */
+void page_table_write_page(struct page_table *pt, int page) {
+    STATS_START(start);
+    pt->ops->write_page(pt, page);
+    STATS_ADD(pt, references, 1);
+    STATS_LATENCY(pt, access_latency, start, 1);
+}
+
+/**
+ * Replays any references OPT is still holding back and writes back the dirty
+ * pages still queued.
+ *
+ * @param pt A page table object.
+ */
+void page_table_flush(struct page_table *pt) {
+    pt->ops->flush(pt);
+    if (pt->writeback_count > 0) {
+        write_back_batch(pt);
+    }
+}
+
+/**
+ * Returns the number of page faults seen so far.
+ *
+ * @param pt A page table object.
+ * @return Number of page faults.
+ */
+long long page_table_get_faults(const struct page_table *pt) {
+    return pt->faults;
+}
+
+/**
+ * Returns the statistics collected so far. OPT holds references back until
+ * page_table_flush, so flush first for complete counts.
+ *
+ * @param pt A page table object.
+ * @param stats Receives the statistics; zeroed if they are not collected.
+ * @return 0 on success, -1 if the build does not define PRA_STATS.
+ */
+int page_table_get_stats(const struct page_table *pt, struct page_table_stats *stats) {
+#ifdef PRA_STATS
+    *stats = pt->stats;
+    stats->faults = pt->faults;
+    stats->hits = stats->references - pt->faults;
+    stats->capacity_faults = pt->faults - stats->cold_faults;
+    return 0;
+#else
+    (void) pt;
+    memset(stats, 0, sizeof(*stats));
+    return -1;
+#endif
+}
+
+#ifdef PRA_STATS
+/**
+ * Prints a latency histogram, one line per non-empty bucket.
+ */
+static void display_histogram(const char *name, const long long *histogram, FILE *out) {
+    fprintf(out, "%s\n", name);
+    for (int b = 0; b < PAGE_TABLE_LATENCY_BUCKETS; b++) {
+        if (histogram[b] > 0) {
+            fprintf(out, "  %10llu - %-10llu %12lld\n", 1ull << b, (2ull << b) - 1, histogram[b]);
+        }
+    }
+}
+#endif
+
+/**
+ * Prints the statistics and the non-empty latency buckets.
+ *
+ * @param pt A page table object.
+ * @param out The stream to print to.
+ */
+void page_table_display_stats(const struct page_table *pt, FILE *out) {
+    struct page_table_stats stats;
+    if (page_table_get_stats(pt, &stats) != 0) {
+        fprintf(out, "Statistics are not collected; configure with -DPRA_STATS=ON\n");
+        return;
+    }
+    fprintf(out, "==== Statistics (%s) ====\n", replacement_algorithm[pt->algorithm]);
+    fprintf(out, "References : %lld\n", stats.references);
+    fprintf(out, "Hits : %lld\n", stats.hits);
+    fprintf(out, "Faults : %lld (cold %lld, capacity %lld)\n", stats.faults, stats.cold_faults, stats.capacity_faults);
+    fprintf(out, "Evictions : %lld\n", stats.evictions);
+    fprintf(out, "Dirty write-backs : %lld\n", stats.dirty_writebacks);
+    fprintf(out, "Victim search steps : %lld\n", stats.victim_steps);
+#ifdef PRA_STATS
+    display_histogram("Access latency (" STATS_CLOCK_UNIT " per reference):", stats.access_latency, out);
+    display_histogram("Fault latency (" STATS_CLOCK_UNIT " per fault):", stats.fault_latency, out);
+#endif
+}
+
+/**
+ * Returns the paging I/O estimated so far: a read for every fault, carrying
+ * the pages read ahead with it, and the clustered write-backs of dirty pages.
+ * Flush first so queued write-backs are counted as written.
+ *
+ * @param pt A page table object.
+ * @param io Receives the estimates.
+ */
+void page_table_get_io(const struct page_table *pt, struct page_table_io *io) {
+    *io = pt->io;
+    io->read_ops = pt->faults;
+    io->pages_read = pt->faults + pt->io.readahead_pages;
+    io->bytes_read = io->pages_read * pt->page_size;
+    io->bytes_written = io->pages_written * pt->page_size;
+}
+
+/**
+ * Prints the I/O estimates.
+ *
+ * @param pt A page table object.
+ * @param out The stream to print to.
+ */
+void page_table_display_io(const struct page_table *pt, FILE *out) {
+    struct page_table_io io;
+    page_table_get_io(pt, &io);
+    fprintf(out, "==== I/O (%s) ====\n", replacement_algorithm[pt->algorithm]);
+    fprintf(out, "Reads : %lld ops, %lld pages, %lld bytes\n", io.read_ops, io.pages_read, io.bytes_read);
+    fprintf(out, "Readahead : %lld pages, %lld hit\n", io.readahead_pages, io.readahead_hits);
+    fprintf(out, "Write-backs : %lld ops, %lld pages, %lld bytes\n", io.write_ops, io.pages_written,
+            io.bytes_written);
+}
+
+/**
+ * Returns the resident set size curve recorded so far. Only WORKING_SET and
+ * WSCLOCK record one, when created with a sample_interval.
+ *
+ * @param pt A page table object.
+ * @param count Set to the number of samples.
+ * @return The samples in time order, owned by the page table.
+ */
+const struct page_table_sample *page_table_series(const struct page_table *pt, int *count) {
+    *count = pt->series_count;
+    return pt->series;
+}
+
+/**
+ * Registers a function called with every page that is evicted from its frame.
+ *
+ * @param pt A page table object.
+ * @param hook The function to call, or NULL to remove it.
+ * @param context Passed to the hook as its first argument.
+ */
+void page_table_set_evict_hook(struct page_table *pt, void (*hook)(void *context, int page), void *context) {
+    pt->evict_hook = hook;
+    pt->evict_context = context;
+}
+
+/**
+ * Returns the number of frames holding a page.
+ *
+ * @param pt A page table object.
+ * @return Number of resident pages.
+ */
+int page_table_resident_count(const struct page_table *pt) {
+    return pt->frame_count - pt->free_count;
+}
+
+/**
+ * Returns the replacement algorithm of a page table.
+ *
+ * @param pt A page table object.
+ * @return The replacement algorithm.
+ */
+enum replacement_algorithm page_table_get_algorithm(const struct page_table *pt) {
+    return pt->algorithm;
+}
+
+/**
+ * Returns the number of pages a page table keeps track of.
+ *
+ * @param pt A page table object.
+ * @return Number of pages.
+ */
+int page_table_get_page_count(const struct page_table *pt) {
+    return pt->page_count;
+}
+
+/**
+ * Returns the number of frames of a page table.
+ *
+ * @param pt A page table object.
+ * @return Number of frames.
+ */
+int page_table_get_frame_count(const struct page_table *pt) {
+    return pt->frame_count;
+}
+
+/**
+ * Returns the name of a replacement algorithm.
+ *
+ * @param algorithm A replacement algorithm.
+ * @return The name of the algorithm, e.g. "LRU".
+ */
+const char *page_table_algorithm_name(enum replacement_algorithm algorithm) {
+    return replacement_algorithm[algorithm];
+}
+
+/**
+ * Looks up a replacement algorithm by name, ignoring case.
+ *
+ * @param name The name of the algorithm, as page_table_algorithm_name gives it.
+ * @param algorithm Receives the algorithm.
+ * @return 0 on success, -1 for an unknown name.
+ */
+int page_table_algorithm_from_name(const char *name, enum replacement_algorithm *algorithm) {
+    for (size_t i = 0; i < sizeof(replacement_algorithm) / sizeof(replacement_algorithm[0]); i++) {
+        if (strcasecmp(name, replacement_algorithm[i]) == 0) {
+            *algorithm = (enum replacement_algorithm) i;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Displays page table replacement algorithm and number of page faults.
+ * page_table_display_contents lists the pages.
+ *
+ * @param pt A page table object.
+ */
+void page_table_display(struct page_table *pt) {
+    page_table_flush(pt);
+    printf("==== Page Table ====\n");
+    printf("Mode : %s\n", replacement_algorithm[pt->algorithm]);
+    printf("Page Faults : %lld\n", pt->faults);
+}
+
+// bytes of page rows formatted before they are written, and the longest row
+#define CONTENTS_BUFFER_SIZE (64 * 1024)
+#define CONTENTS_ROW_SIZE 64
+
+/**
+ * Formats the row of one page into the buffer, writing the buffer out first
+ * if the row might not fit.
+ * @return the new length of the buffer
+ */
+static size_t append_contents_row(const struct page_table *pt, int page, char *buffer, size_t length, FILE *out) {
+    if (CONTENTS_BUFFER_SIZE - length < CONTENTS_ROW_SIZE) {
+        fwrite(buffer, 1, length, out);
+        length = 0;
+    }
+    return length + (size_t) snprintf(buffer + length, CONTENTS_ROW_SIZE, "%4d %4d | %5d %5d\n", page,
+                                      page_last_frame(pt, page), page_test(pt, page, DIRTY_BIT),
+                                      page_test(pt, page, VALID_BIT));
+}
+
+/**
+ * Displays the current contents of the page table. Rows are formatted into a
+ * buffer and written in large blocks, since a dense table has a row for every
+ * page.
+ *
+ * @param pt A page table object.
+ * @param out The stream to print to.
+ */
+void page_table_display_contents(const struct page_table *pt, FILE *out) {
+    char *buffer = (char *) malloc(CONTENTS_BUFFER_SIZE);
+    size_t length = (size_t) snprintf(buffer, CONTENTS_ROW_SIZE, "page frame | dirty valid\n");
+    if (pt->backend == DENSE_TABLE) {
+        for (int i = 0; i < pt->page_count; ++i) {
+            length = append_contents_row(pt, i, buffer, length, out);
+        }
+    } else {
+        // a sparse table only knows the pages it has touched; list them in page order
+        int *pages = (int *) malloc(sizeof(int) * (pt->sparse.size > 0 ? pt->sparse.size : 1));
+        int_map_keys(&(pt->sparse), pages);
+        qsort(pages, pt->sparse.size, sizeof(int), compare_ints);
+        for (unsigned i = 0; i < pt->sparse.size; ++i) {
+            length = append_contents_row(pt, pages[i], buffer, length, out);
+        }
+        free(pages);
     }
+    fwrite(buffer, 1, length, out);
+    free(buffer);
 }
@@ -0,0 +1,216 @@
+/*
+ * Spatially hashed trace sampling.
+ *
+ * Neighbouring frame counts usually scale to the same sampled frame count, so
+ * page tables are built once per distinct sampled frame count and shared by
+ * every frame count that maps to it. With a rate of 1% a sweep over 2000
+ * frame counts replays only 20 small tables per policy and seed.
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include "Shards.h"
+#include "Simulation.h"
+
+// a page is sampled when the low SAMPLE_BITS of its hash are below rate * 2^SAMPLE_BITS
+#define SAMPLE_BITS 24
+
+/**
+ * Hashes a page number for a sample (murmur3 finalizer).
+ * @param page the page to hash
+ * @param seed the sample the hash is for
+ * @return the hash
+ */
+static uint32_t sample_hash(int page, uint32_t seed) {
+    uint32_t h = (uint32_t) page * 0x9E3779B9u ^ (seed * 0x85EBCA77u + 0x165667B1u);
+    h ^= h >> 16;
+    h *= 0x85EBCA6Bu;
+    h ^= h >> 13;
+    h *= 0xC2B2AE35u;
+    h ^= h >> 16;
+    return h;
+}
+
+/**
+ * Returns the sampled frame count standing in for a full frame count.
+ */
+static int sampled_frames(int frame_count, double rate) {
+    long frames = lround(frame_count * rate);
+    return frames < 1 ? 1 : (int) frames;
+}
+
+/**
+ * Estimates fault curves from sampled traces. Every sample keeps the pages a
+ * seeded hash puts below rate and replays them with frame_count * rate
+ * frames on the sparse backend; its fault count is scaled back up by
+ * 1 / rate. All samples share one pass over the trace.
+ *
+ * @param filename The trace to replay.
+ * @param policies The policies to evaluate.
+ * @param policy_count Number of policies.
+ * @param min_frames Smallest frame count, at least 1.
+ * @param max_frames Largest frame count.
+ * @param rate Fraction of pages to sample, in (0, 1].
+ * @param seed_count Number of independent samples, at least 1.
+ * @return The estimated fault curves, or NULL if the trace could not be read.
+ */
+struct shards_result* shards_run(char* filename, const enum replacement_algorithm* policies, int policy_count,
+                                 int min_frames, int max_frames, double rate, int seed_count) {
+    if (!(rate > 0 && rate <= 1)) {
+        printf("Sampling rate %g is not in (0, 1]\n", rate);
+        return NULL;
+    }
+    struct trace_reader *reader = trace_reader_open(filename);
+    if (!reader) {
+        return NULL;
+    }
+    const struct trace_header *header = trace_reader_header(reader);
+
+    if (min_frames < 1) {
+        min_frames = 1;
+    }
+    if (max_frames < min_frames) {
+        max_frames = min_frames;
+    }
+    if (seed_count < 1) {
+        seed_count = 1;
+    }
+    uint32_t threshold = (uint32_t) llround(rate * (1u << SAMPLE_BITS));
+    if (threshold == 0) {
+        threshold = 1;
+    }
+    // frame counts scale by the rate the threshold actually samples at
+    rate = (double) threshold / (1u << SAMPLE_BITS);
+
+    // one table per (seed, sampled frame count, policy)
+    int min_sampled = sampled_frames(min_frames, rate);
+    int sampled_span = sampled_frames(max_frames, rate) - min_sampled + 1;
+    int tables_per_seed = sampled_span * policy_count;
+    struct page_table **tables = (struct page_table **) malloc(sizeof(struct page_table *) * tables_per_seed * seed_count);
+    for (int s = 0; s < seed_count; s++) {
+        for (int f = 0; f < sampled_span; f++) {
+            for (int p = 0; p < policy_count; p++) {
+                struct page_table_config config;
+                page_table_config_init(&config, header->page_count, min_sampled + f, policies[p]);
+                config.backend = SPARSE_TABLE;
+                tables[s * tables_per_seed + f * policy_count + p] = page_table_create_config(&config);
+            }
+        }
+    }
+
+    // replay the trace once, splitting every chunk into the samples
+    int *chunk = (int *) malloc(sizeof(int) * TRACE_CHUNK_SIZE);
+    int *sample = (int *) malloc(sizeof(int) * TRACE_CHUNK_SIZE);
+    long long *sampled_refs = (long long *) calloc(seed_count, sizeof(long long));
+    int status = 0;
+    int n;
+    while ((n = trace_reader_next_chunk(reader, chunk, TRACE_CHUNK_SIZE)) > 0) {
+        for (int s = 0; s < seed_count; s++) {
+            int m = 0;
+            for (int i = 0; i < n; i++) {
+                sample[m] = chunk[i];
+                m += (sample_hash(chunk[i], (uint32_t) s) & ((1u << SAMPLE_BITS) - 1)) < threshold;
+            }
+            page_tables_access_pages(tables + s * tables_per_seed, tables_per_seed, sample, m);
+            sampled_refs[s] += m;
+        }
+    }
+    if (n < 0) {
+        status = -1;
+    }
+
+    struct shards_result *result = NULL;
+    if (status == 0) {
+        result = (struct shards_result *) malloc(sizeof(struct shards_result));
+        result->min_frames = min_frames;
+        result->max_frames = max_frames;
+        result->policy_count = policy_count;
+        result->policies = (enum replacement_algorithm *) malloc(sizeof(enum replacement_algorithm) * policy_count);
+        for (int i = 0; i < policy_count; i++) {
+            result->policies[i] = policies[i];
+        }
+        result->rate = rate;
+        result->seed_count = seed_count;
+        result->length = header->length;
+        result->sampled_length = 0;
+        for (int s = 0; s < seed_count; s++) {
+            result->sampled_length += (double) sampled_refs[s] / seed_count;
+        }
+
+        int count = (max_frames - min_frames + 1) * policy_count;
+        result->mean_faults = (double *) calloc(count, sizeof(double));
+        result->stddev_faults = (double *) calloc(count, sizeof(double));
+        double *estimates = (double *) malloc(sizeof(double) * seed_count);
+        for (int f = min_frames; f <= max_frames; f++) {
+            int table = (sampled_frames(f, rate) - min_sampled) * policy_count;
+            for (int p = 0; p < policy_count; p++) {
+                // scale by the rate rather than by the references a sample
+                // kept: a few hot pages decide how many references survive,
+                // but being hot they take few of the faults
+                double mean = 0;
+                for (int s = 0; s < seed_count; s++) {
+                    struct page_table *pt = tables[s * tables_per_seed + table + p];
+                    page_table_flush(pt);
+                    estimates[s] = page_table_get_faults(pt) / rate;
+                    mean += estimates[s] / seed_count;
+                }
+                double variance = 0;
+                for (int s = 0; s < seed_count; s++) {
+                    variance += (estimates[s] - mean) * (estimates[s] - mean);
+                }
+                int index = (f - min_frames) * policy_count + p;
+                result->mean_faults[index] = mean;
+                result->stddev_faults[index] = seed_count > 1 ? sqrt(variance / (seed_count - 1)) : 0;
+            }
+        }
+        free(estimates);
+    }
+
+    for (int i = 0; i < tables_per_seed * seed_count; i++) {
+        page_table_destroy(&(tables[i]));
+    }
+    free(tables);
+    free(chunk);
+    free(sample);
+    free(sampled_refs);
+    trace_reader_close(&reader);
+    return result;
+}
+
+/**
+ * Destroys a sampling result. Sets outside variable to NULL.
+ *
+ * @param result A sampling result.
+ */
+void shards_destroy(struct shards_result** result) {
+    free((*result)->policies);
+    free((*result)->mean_faults);
+    free((*result)->stddev_faults);
+    free(*result);
+    *result = NULL;
+}
+
+/**
+ * Prints the estimated fault curves with one row per frame count and, for
+ * every policy, the mean estimate and its standard deviation over samples.
+ *
+ * @param result A sampling result.
+ * @param out The stream to print to.
+ */
+void shards_display(const struct shards_result* result, FILE* out) {
+    fprintf(out, "sampled %.0f of %lld references (rate %.4g, %d samples)\n",
+            result->sampled_length, result->length, result->rate, result->seed_count);
+    fprintf(out, "%8s", "frames");
+    for (int p = 0; p < result->policy_count; p++) {
+        fprintf(out, " %12s %10s", page_table_algorithm_name(result->policies[p]), "+/-");
+    }
+    fprintf(out, "\n");
+    for (int f = result->min_frames; f <= result->max_frames; f++) {
+        int row = (f - result->min_frames) * result->policy_count;
+        fprintf(out, "%8d", f);
+        for (int p = 0; p < result->policy_count; p++) {
+            fprintf(out, " %12.0f %10.0f", result->mean_faults[row + p], result->stddev_faults[row + p]);
+        }
+        fprintf(out, "\n");
+    }
+}
@@ -0,0 +1,228 @@
+/*
+ * Mattson stack-distance analysis over a Fenwick tree of last-access times.
+ *
+ * Every page's most recent access occupies one time slot, marked with a 1 in
+ * the tree. The stack distance of a re-reference is the number of marked slots
+ * from its previous access to now, i.e. the number of distinct pages touched
+ * in between plus itself. Slots are renumbered densely whenever the clock runs
+ * out, so the tree stays at twice page_count no matter how long the trace is.
+ */
+
+#include <string.h>
+#include "StackDistance.h"
+
+static const int NEVER = -1;
+
+struct stack_distance {
+    int page_count;
+    // slot of the most recent access of every page, or NEVER
+    int *last_slot;
+    // page whose most recent access is in a slot, or NEVER
+    int *slot_page;
+    // Fenwick tree over slots, 1-based
+    int *tree;
+    int slot_count;
+    // next slot to hand out
+    int clock;
+    // number of first references
+    long long cold_misses;
+    // histogram[d] counts re-references at stack distance d, 1 <= d <= page_count
+    long long *histogram;
+    long long accesses;
+};
+
+// Fenwick tree functions
+
+static void tree_add(struct stack_distance *sd, int slot, int delta) {
+    for (int i = slot + 1; i <= sd->slot_count; i += i & -i) {
+        sd->tree[i] += delta;
+    }
+}
+
+// number of marked slots in [0, slot]
+static int tree_prefix(const struct stack_distance *sd, int slot) {
+    int sum = 0;
+    for (int i = slot + 1; i > 0; i -= i & -i) {
+        sum += sd->tree[i];
+    }
+    return sum;
+}
+
+/**
+ * Renumbers the live slots densely from 0, preserving their order, and
+ * rebuilds the tree in linear time.
+ */
+static void compact_slots(struct stack_distance *sd) {
+    int live = 0;
+    for (int slot = 0; slot < sd->clock; slot++) {
+        int page = sd->slot_page[slot];
+        if (page != NEVER) {
+            sd->slot_page[live] = page;
+            sd->last_slot[page] = live;
+            live++;
+        }
+    }
+    for (int slot = live; slot < sd->slot_count; slot++) {
+        sd->slot_page[slot] = NEVER;
+    }
+
+    memset(sd->tree, 0, sizeof(int) * (sd->slot_count + 1));
+    for (int i = 1; i <= sd->slot_count; i++) {
+        if (i <= live) {
+            sd->tree[i] += 1;
+        }
+        int parent = i + (i & -i);
+        if (parent <= sd->slot_count) {
+            sd->tree[parent] += sd->tree[i];
+        }
+    }
+    sd->clock = live;
+}
+
+// - End of Fenwick tree functions
+
+/**
+ * Creates a new stack-distance analyzer.
+ *
+ * @param page_count Number of pages.
+ * @return A stack-distance analyzer.
+ */
+struct stack_distance* stack_distance_create(int page_count) {
+    struct stack_distance *sd = (struct stack_distance *) malloc(sizeof(struct stack_distance));
+    sd->page_count = page_count;
+    sd->slot_count = 2 * page_count + 2;
+    sd->last_slot = (int *) malloc(sizeof(int) * page_count);
+    sd->slot_page = (int *) malloc(sizeof(int) * sd->slot_count);
+    sd->tree = (int *) calloc(sd->slot_count + 1, sizeof(int));
+    sd->histogram = (long long *) calloc(page_count + 1, sizeof(long long));
+    for (int i = 0; i < page_count; i++) {
+        sd->last_slot[i] = NEVER;
+    }
+    for (int i = 0; i < sd->slot_count; i++) {
+        sd->slot_page[i] = NEVER;
+    }
+    sd->clock = 0;
+    sd->cold_misses = 0;
+    sd->accesses = 0;
+    return sd;
+}
+
+/**
+ * Destroys a stack-distance analyzer. Sets outside variable to NULL.
+ *
+ * @param sd A stack-distance analyzer.
+ */
+void stack_distance_destroy(struct stack_distance** sd) {
+    free((*sd)->last_slot);
+    free((*sd)->slot_page);
+    free((*sd)->tree);
+    free((*sd)->histogram);
+    free(*sd);
+    *sd = NULL;
+}
+
+/**
+ * Records an access to a page. Costs O(log page_count).
+ *
+ * @param sd A stack-distance analyzer.
+ * @param page The page being accessed.
+ */
+void stack_distance_access_page(struct stack_distance* sd, int page) {
+    if (sd->clock == sd->slot_count) {
+        compact_slots(sd);
+    }
+
+    int last = sd->last_slot[page];
+    if (last == NEVER) {
+        sd->cold_misses++;
+    } else {
+        // distinct pages touched since the previous access, including this one
+        int distance = tree_prefix(sd, sd->clock - 1) - tree_prefix(sd, last - 1);
+        sd->histogram[distance]++;
+        tree_add(sd, last, -1);
+        sd->slot_page[last] = NEVER;
+    }
+
+    tree_add(sd, sd->clock, 1);
+    sd->slot_page[sd->clock] = page;
+    sd->last_slot[page] = sd->clock;
+    sd->clock++;
+    sd->accesses++;
+}
+
+/**
+ * Records a batch of accesses.
+ *
+ * @param sd A stack-distance analyzer.
+ * @param pages The pages being accessed.
+ * @param n Number of pages.
+ */
+void stack_distance_access_pages(struct stack_distance* sd, const int* pages, int n) {
+    for (int i = 0; i < n; i++) {
+        stack_distance_access_page(sd, pages[i]);
+    }
+}
+
+/**
+ * Streams a trace through the analyzer, starting at the reader's current
+ * position.
+ *
+ * @param reader The trace to replay.
+ * @param sd A stack-distance analyzer.
+ * @return 0 on success, -1 if the trace could not be read.
+ */
+int stack_distance_simulate_trace(struct trace_reader* reader, struct stack_distance* sd) {
+    int chunk[TRACE_CHUNK_SIZE];
+    int n;
+    while ((n = trace_reader_next_chunk(reader, chunk, TRACE_CHUNK_SIZE)) > 0) {
+        stack_distance_access_pages(sd, chunk, n);
+    }
+    return n;
+}
+
+/**
+ * Returns the number of faults LRU would have taken with the given number of
+ * frames over the accesses recorded so far.
+ *
+ * @param sd A stack-distance analyzer.
+ * @param frame_count Numbers of frames.
+ * @return Number of page faults.
+ */
+long long stack_distance_faults(const struct stack_distance* sd, int frame_count) {
+    long long faults = sd->cold_misses;
+    for (int d = frame_count + 1; d <= sd->page_count; d++) {
+        faults += sd->histogram[d];
+    }
+    return faults;
+}
+
+/**
+ * Prints the LRU miss-ratio curve: faults and miss ratio for every frame
+ * count in a range.
+ *
+ * @param sd A stack-distance analyzer.
+ * @param min_frames Smallest frame count.
+ * @param max_frames Largest frame count.
+ * @param out The stream to print to.
+ */
+void stack_distance_display(const struct stack_distance* sd, int min_frames, int max_frames, FILE* out) {
+    if (min_frames < 1) {
+        min_frames = 1;
+    }
+    if (max_frames > sd->page_count) {
+        max_frames = sd->page_count;
+    }
+    fprintf(out, "%8s %12s %10s\n", "frames", "LRU faults", "miss ratio");
+    // walk the histogram once from the top, accumulating faults as frames shrink
+    long long faults = stack_distance_faults(sd, max_frames);
+    long long *curve = (long long *) malloc(sizeof(long long) * (max_frames >= min_frames ? max_frames - min_frames + 1 : 1));
+    for (int f = max_frames; f >= min_frames; f--) {
+        curve[f - min_frames] = faults;
+        faults += sd->histogram[f];
+    }
+    for (int f = min_frames; f <= max_frames; f++) {
+        double ratio = sd->accesses > 0 ? (double) curve[f - min_frames] / (double) sd->accesses : 0.0;
+        fprintf(out, "%8d %12lld %10.6f\n", f, curve[f - min_frames], ratio);
+    }
+    free(curve);
+}
@@ -0,0 +1,232 @@
+/*
+ * Stream-VByte coding of zigzag deltas.
+ *
+ * The vector decoders handle one control byte, four values, per step: a
+ * table lookup turns the control byte into a byte shuffle that spreads the
+ * 4 to 16 value bytes over four 32-bit lanes, and another into the number of
+ * bytes to advance. Zigzag decoding and the running sum are done in the same
+ * registers with two shifted adds. Every step loads 16 bytes, so the vector
+ * loop stops once fewer than 16 bytes remain and the scalar decoder, which
+ * checks every value against the end of the input, finishes the run.
+ */
+
+#include <pthread.h>
+#include "StreamVByte.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define STREAM_VBYTE_SSSE3 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define STREAM_VBYTE_NEON 1
+#endif
+
+#if defined(STREAM_VBYTE_SSSE3) || defined(STREAM_VBYTE_NEON)
+// per control byte: the shuffle gathering four values, and their total length
+static uint8_t shuffle_table[256][16];
+static uint8_t length_table[256];
+static pthread_once_t tables_once = PTHREAD_ONCE_INIT;
+
+static void build_tables(void) {
+    for (int c = 0; c < 256; c++) {
+        int offset = 0;
+        for (int lane = 0; lane < 4; lane++) {
+            int len = ((c >> (2 * lane)) & 3) + 1;
+            for (int b = 0; b < 4; b++) {
+                // 0xFF makes the shuffle write a zero byte
+                shuffle_table[c][4 * lane + b] = (uint8_t) (b < len ? offset + b : 0xFF);
+            }
+            offset += len;
+        }
+        length_table[c] = (uint8_t) offset;
+    }
+}
+#endif
+
+static uint32_t zigzag_encode(uint32_t delta) {
+    return (delta << 1) ^ (uint32_t) -(int32_t) (delta >> 31);
+}
+
+static uint32_t zigzag_decode(uint32_t value) {
+    return (value >> 1) ^ (uint32_t) -(int32_t) (value & 1);
+}
+
+/**
+ * Decodes values start to n one at a time.
+ * @param ctrl the control bytes
+ * @param data the next value byte; advanced past the decoded values
+ * @param end the end of the input
+ * @param prev the previous value; updated to the last decoded value
+ * @return 1 on success, 0 if the input ends early
+ */
+static int decode_scalar(const unsigned char *ctrl, const unsigned char **data, const unsigned char *end,
+                         size_t start, size_t n, uint32_t *prev, int *out) {
+    const unsigned char *p = *data;
+    uint32_t value = *prev;
+    for (size_t i = start; i < n; i++) {
+        int len = ((ctrl[i / 4] >> (2 * (i % 4))) & 3) + 1;
+        if ((size_t) (end - p) < (size_t) len) {
+            return 0;
+        }
+        uint32_t zz = 0;
+        for (int b = 0; b < len; b++) {
+            zz |= (uint32_t) p[b] << (8 * b);
+        }
+        p += len;
+        value += zigzag_decode(zz);
+        out[i] = (int) value;
+    }
+    *data = p;
+    *prev = value;
+    return 1;
+}
+
+#ifdef STREAM_VBYTE_SSSE3
+
+/**
+ * Decodes whole groups of four values while 16 input bytes remain.
+ * @return number of values decoded
+ */
+__attribute__((target("ssse3")))
+static size_t decode_ssse3(const unsigned char *ctrl, const unsigned char **data, const unsigned char *end,
+                           size_t n, uint32_t *prev, int *out) {
+    const unsigned char *p = *data;
+    __m128i running = _mm_set1_epi32((int) *prev);
+    __m128i one = _mm_set1_epi32(1);
+    size_t i = 0;
+    for (; i + 4 <= n && end - p >= 16; i += 4) {
+        uint8_t c = ctrl[i / 4];
+        __m128i shuffle = _mm_loadu_si128((const __m128i *) shuffle_table[c]);
+        __m128i v = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) p), shuffle);
+        p += length_table[c];
+        // zigzag decode, then prefix-sum the four deltas onto the running value
+        v = _mm_xor_si128(_mm_srli_epi32(v, 1), _mm_sub_epi32(_mm_setzero_si128(), _mm_and_si128(v, one)));
+        v = _mm_add_epi32(v, _mm_slli_si128(v, 4));
+        v = _mm_add_epi32(v, _mm_slli_si128(v, 8));
+        v = _mm_add_epi32(v, running);
+        _mm_storeu_si128((__m128i *) (out + i), v);
+        running = _mm_shuffle_epi32(v, 0xFF);
+    }
+    *data = p;
+    *prev = (uint32_t) _mm_cvtsi128_si32(running);
+    return i;
+}
+
+static int has_ssse3(void) {
+    return __builtin_cpu_supports("ssse3");
+}
+
+#endif
+
+#ifdef STREAM_VBYTE_NEON
+
+/**
+ * Decodes whole groups of four values while 16 input bytes remain.
+ * @return number of values decoded
+ */
+static size_t decode_neon(const unsigned char *ctrl, const unsigned char **data, const unsigned char *end,
+                          size_t n, uint32_t *prev, int *out) {
+    const unsigned char *p = *data;
+    uint32x4_t running = vdupq_n_u32(*prev);
+    uint32x4_t zero = vdupq_n_u32(0);
+    uint32x4_t one = vdupq_n_u32(1);
+    size_t i = 0;
+    for (; i + 4 <= n && end - p >= 16; i += 4) {
+        uint8_t c = ctrl[i / 4];
+        uint8x16_t bytes = vqtbl1q_u8(vld1q_u8(p), vld1q_u8(shuffle_table[c]));
+        p += length_table[c];
+        uint32x4_t v = vreinterpretq_u32_u8(bytes);
+        v = veorq_u32(vshrq_n_u32(v, 1), vsubq_u32(zero, vandq_u32(v, one)));
+        v = vaddq_u32(v, vextq_u32(zero, v, 3));
+        v = vaddq_u32(v, vextq_u32(zero, v, 2));
+        v = vaddq_u32(v, running);
+        vst1q_u32((uint32_t *) (out + i), v);
+        running = vdupq_n_u32(vgetq_lane_u32(v, 3));
+    }
+    *data = p;
+    *prev = vgetq_lane_u32(running, 0);
+    return i;
+}
+
+#endif
+
+/**
+ * Encodes the differences between consecutive values, the first one relative
+ * to 0. Differences are zigzag coded so small negative steps stay small too.
+ *
+ * @param values The values to encode.
+ * @param n Number of values.
+ * @param out Receives the encoding, at least stream_vbyte_max_size(n) bytes.
+ * @return Number of bytes written.
+ */
+size_t stream_vbyte_encode_delta(const int *values, size_t n, unsigned char *out) {
+    size_t ctrl_len = (n + 3) / 4;
+    unsigned char *ctrl = out;
+    unsigned char *p = out + ctrl_len;
+    uint32_t prev = 0;
+    for (size_t i = 0; i < ctrl_len; i++) {
+        ctrl[i] = 0;
+    }
+    for (size_t i = 0; i < n; i++) {
+        uint32_t zz = zigzag_encode((uint32_t) values[i] - prev);
+        prev = (uint32_t) values[i];
+        int len = zz < (1u << 8) ? 1 : zz < (1u << 16) ? 2 : zz < (1u << 24) ? 3 : 4;
+        ctrl[i / 4] |= (unsigned char) ((len - 1) << (2 * (i % 4)));
+        for (int b = 0; b < len; b++) {
+            p[b] = (unsigned char) (zz >> (8 * b));
+        }
+        p += len;
+    }
+    return (size_t) (p - out);
+}
+
+/**
+ * Decodes n values written by stream_vbyte_encode_delta.
+ *
+ * @param in The encoding.
+ * @param in_len Number of bytes available at in; the decoder never reads
+ * past them.
+ * @param n Number of values to decode.
+ * @param out Receives the values.
+ * @return Number of bytes consumed, 0 if the encoding is shorter than n
+ * values need.
+ */
+size_t stream_vbyte_decode_delta(const unsigned char *in, size_t in_len, size_t n, int *out) {
+    size_t ctrl_len = (n + 3) / 4;
+    if (in_len < ctrl_len) {
+        return 0;
+    }
+    const unsigned char *data = in + ctrl_len;
+    const unsigned char *end = in + in_len;
+    uint32_t prev = 0;
+    size_t i = 0;
+#if defined(STREAM_VBYTE_SSSE3)
+    if (has_ssse3()) {
+        pthread_once(&tables_once, build_tables);
+        i = decode_ssse3(in, &data, end, n, &prev, out);
+    }
+#elif defined(STREAM_VBYTE_NEON)
+    pthread_once(&tables_once, build_tables);
+    i = decode_neon(in, &data, end, n, &prev, out);
+#endif
+    if (!decode_scalar(in, &data, end, i, n, &prev, out)) {
+        return 0;
+    }
+    return (size_t) (data - in);
+}
+
+/**
+ * Returns the name of the kernel stream_vbyte_decode_delta uses on this CPU.
+ *
+ * @return "ssse3", "neon" or "scalar".
+ */
+const char *stream_vbyte_kernel(void) {
+#if defined(STREAM_VBYTE_SSSE3)
+    if (has_ssse3()) {
+        return "ssse3";
+    }
+#elif defined(STREAM_VBYTE_NEON)
+    return "neon";
+#endif
+    return "scalar";
+}
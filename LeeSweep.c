@@ -0,0 +1,206 @@
+/*
+ * Frame-count sweeps across a pool of threads.
+ */
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include "Sweep.h"
+#include "Simulation.h"
+
+// number of page tables a worker replays together in one pass over the trace
+#define SWEEP_BATCH_SIZE 32
+
+// state shared by all workers of a sweep
+struct sweep_job {
+    char *filename;
+    struct sweep_result *result;
+    int page_count;
+    int task_count;
+    // index of the next (frame_count, policy) pair to hand out
+    atomic_int next_task;
+    atomic_int failed;
+};
+
+/**
+ * Worker loop: claims batches of (frame_count, policy) pairs until none are
+ * left, and replays the trace once per batch.
+ * @param arg the sweep_job
+ * @return NULL
+ */
+static void *sweep_worker(void *arg) {
+    struct sweep_job *job = (struct sweep_job *) arg;
+    struct sweep_result *result = job->result;
+    struct trace_reader *reader = trace_reader_open(job->filename);
+    if (!reader) {
+        atomic_store(&(job->failed), 1);
+        return NULL;
+    }
+
+    struct page_table *tables[SWEEP_BATCH_SIZE];
+    struct page_table_config configs[SWEEP_BATCH_SIZE];
+    size_t offsets[SWEEP_BATCH_SIZE];
+    // the tables of a batch are carved out of one block, regrown as frame counts rise
+    unsigned char *block = NULL;
+    size_t block_size = 0;
+    for (;;) {
+        int first = atomic_fetch_add(&(job->next_task), SWEEP_BATCH_SIZE);
+        if (first >= job->task_count) {
+            break;
+        }
+        int count = job->task_count - first < SWEEP_BATCH_SIZE ? job->task_count - first : SWEEP_BATCH_SIZE;
+        size_t needed = 0;
+        for (int i = 0; i < count; i++) {
+            int task = first + i;
+            int frame_count = result->min_frames + task / result->policy_count;
+            enum replacement_algorithm policy = result->policies[task % result->policy_count];
+            page_table_config_init(&(configs[i]), job->page_count, frame_count, policy);
+            offsets[i] = needed;
+            needed += page_table_arena_size(&(configs[i]));
+        }
+        if (needed > block_size) {
+            free(block);
+            block_size = 2 * needed;
+            block = (unsigned char *) aligned_alloc(64, block_size);
+            if (!block) {
+                block_size = 0;
+                atomic_store(&(job->failed), 1);
+                break;
+            }
+        }
+        int created = 1;
+        for (int i = 0; i < count; i++) {
+            tables[i] = page_table_create_in(&(configs[i]), block + offsets[i], block_size - offsets[i]);
+            created = created && tables[i];
+        }
+        if (!created) {
+            atomic_store(&(job->failed), 1);
+            for (int i = 0; i < count; i++) {
+                if (tables[i]) {
+                    page_table_destroy(&(tables[i]));
+                }
+            }
+            break;
+        }
+
+        if (trace_reader_rewind(reader) != 0 || simulate_trace(reader, tables, count) != 0) {
+            atomic_store(&(job->failed), 1);
+        }
+        for (int i = 0; i < count; i++) {
+            result->faults[first + i] = page_table_get_faults(tables[i]);
+            page_table_destroy(&(tables[i]));
+        }
+    }
+
+    free(block);
+    trace_reader_close(&reader);
+    return NULL;
+}
+
+/**
+ * Runs a sweep over a trace. One page table is built for every pair of policy
+ * and frame count; the tables are sharded across a pool of threads, each of
+ * which streams the trace through its share with its own reader.
+ *
+ * @param filename The trace to replay.
+ * @param policies The policies to sweep.
+ * @param policy_count Number of policies.
+ * @param min_frames Smallest frame count, at least 1.
+ * @param max_frames Largest frame count.
+ * @param thread_count Number of worker threads, at least 1.
+ * @return The fault curves, or NULL if the trace could not be read or a page
+ * table could not be created.
+ */
+struct sweep_result* sweep_run(char* filename, const enum replacement_algorithm* policies, int policy_count,
+                               int min_frames, int max_frames, int thread_count) {
+    struct trace_reader *reader = trace_reader_open(filename);
+    if (!reader) {
+        return NULL;
+    }
+    int page_count = trace_reader_header(reader)->page_count;
+    trace_reader_close(&reader);
+
+    if (min_frames < 1) {
+        min_frames = 1;
+    }
+    if (max_frames < min_frames) {
+        max_frames = min_frames;
+    }
+    if (thread_count < 1) {
+        thread_count = 1;
+    }
+
+    struct sweep_result *result = (struct sweep_result *) malloc(sizeof(struct sweep_result));
+    result->min_frames = min_frames;
+    result->max_frames = max_frames;
+    result->policy_count = policy_count;
+    result->policies = (enum replacement_algorithm *) malloc(sizeof(enum replacement_algorithm) * policy_count);
+    for (int i = 0; i < policy_count; i++) {
+        result->policies[i] = policies[i];
+    }
+
+    struct sweep_job job;
+    job.filename = filename;
+    job.result = result;
+    job.page_count = page_count;
+    job.task_count = (max_frames - min_frames + 1) * policy_count;
+    atomic_init(&(job.next_task), 0);
+    atomic_init(&(job.failed), 0);
+    result->faults = (long long *) calloc(job.task_count > 0 ? job.task_count : 1, sizeof(long long));
+
+    pthread_t *threads = (pthread_t *) malloc(sizeof(pthread_t) * thread_count);
+    int started = 0;
+    for (int i = 0; i < thread_count; i++) {
+        if (pthread_create(&(threads[i]), NULL, sweep_worker, &job) != 0) {
+            break;
+        }
+        started++;
+    }
+    if (started == 0) {
+        // no threads available; do the work on the calling thread
+        sweep_worker(&job);
+    }
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+
+    if (atomic_load(&(job.failed))) {
+        sweep_destroy(&result);
+    }
+    return result;
+}
+
+/**
+ * Destroys a sweep result. Sets outside variable to NULL.
+ *
+ * @param result A sweep result.
+ */
+void sweep_destroy(struct sweep_result** result) {
+    free((*result)->policies);
+    free((*result)->faults);
+    free(*result);
+    *result = NULL;
+}
+
+/**
+ * Prints the fault curves as a table with one row per frame count and one
+ * column per policy.
+ *
+ * @param result A sweep result.
+ * @param out The stream to print to.
+ */
+void sweep_display(const struct sweep_result* result, FILE* out) {
+    fprintf(out, "%8s", "frames");
+    for (int p = 0; p < result->policy_count; p++) {
+        fprintf(out, " %12s", page_table_algorithm_name(result->policies[p]));
+    }
+    fprintf(out, "\n");
+    for (int f = result->min_frames; f <= result->max_frames; f++) {
+        const long long *row = result->faults + (long long) (f - result->min_frames) * result->policy_count;
+        fprintf(out, "%8d", f);
+        for (int p = 0; p < result->policy_count; p++) {
+            fprintf(out, " %12lld", row[p]);
+        }
+        fprintf(out, "\n");
+    }
+}
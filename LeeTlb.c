@@ -0,0 +1,335 @@
+/*
+ * Set-associative TLBs.
+ *
+ * Every set is padded to TLB_MAX_WAYS tags so a lookup is a fixed-length tag
+ * compare that builds a match mask without branches; the compiler turns it
+ * into a couple of vector compares. Unused ways hold a tag no page can match.
+ * Replacement within a set reuses the counter engines of the page table
+ * policies: FIFO and LRU keep 32-bit stamps, NFU saturating counts, all
+ * scanned with counter_argmin, and CLOCK keeps referenced bits and a hand.
+ */
+
+#include <stdint.h>
+#include "Tlb.h"
+#include "CounterScan.h"
+
+// tag of an empty way, and of the padding ways beyond the configured ones
+static const int EMPTY_TAG = -1;
+static const int PADDING_TAG = -2;
+
+struct tlb {
+    int sets;
+    int ways;
+    enum replacement_algorithm policy;
+    // tags[set * TLB_MAX_WAYS + way]
+    int *tags;
+    // FIFO/LRU stamps, NFU counts or CLOCK referenced bits, laid out like tags
+    uint32_t *meta;
+    // CLOCK hand of every set
+    int *hands;
+    // stamp source for FIFO and LRU
+    uint32_t clock;
+};
+
+struct tlb_hierarchy {
+    struct tlb *levels[2];
+    struct tlb_stats stats[2];
+    struct page_table *pt;
+};
+
+/**
+ * Returns a bit mask of the ways of a set holding tag.
+ */
+static inline unsigned match_ways(const int *set_tags, int tag) {
+    unsigned mask = 0;
+    for (int way = 0; way < TLB_MAX_WAYS; way++) {
+        mask |= (unsigned) (set_tags[way] == tag) << way;
+    }
+    return mask;
+}
+
+/**
+ * Creates a TLB.
+ *
+ * @param config The geometry and replacement policy of the TLB.
+ * @return A TLB object, or NULL if the configuration is invalid.
+ */
+struct tlb *tlb_create(const struct tlb_config *config) {
+    if (config->sets < 1 || config->ways < 1 || config->ways > TLB_MAX_WAYS) {
+        printf("A TLB needs at least one set and 1 to %d ways, not %d x %d\n",
+               TLB_MAX_WAYS, config->sets, config->ways);
+        return NULL;
+    }
+    if (config->policy != FIFO && config->policy != LRU && config->policy != NFU && config->policy != CLOCK) {
+        printf("TLBs support FIFO, LRU, NFU and CLOCK, not %s\n", page_table_algorithm_name(config->policy));
+        return NULL;
+    }
+    struct tlb *tlb = (struct tlb *) malloc(sizeof(struct tlb));
+    tlb->sets = config->sets;
+    tlb->ways = config->ways;
+    tlb->policy = config->policy;
+    size_t entries = (size_t) config->sets * TLB_MAX_WAYS;
+    tlb->tags = (int *) malloc(sizeof(int) * entries);
+    tlb->meta = (uint32_t *) calloc(entries, sizeof(uint32_t));
+    tlb->hands = (int *) calloc((size_t) config->sets, sizeof(int));
+    for (size_t i = 0; i < entries; i++) {
+        tlb->tags[i] = (int) (i % TLB_MAX_WAYS) < config->ways ? EMPTY_TAG : PADDING_TAG;
+    }
+    tlb->clock = 0;
+    return tlb;
+}
+
+/**
+ * Destroys a TLB. Sets outside variable to NULL.
+ *
+ * @param tlb A TLB object.
+ */
+void tlb_destroy(struct tlb **tlb) {
+    free((*tlb)->tags);
+    free((*tlb)->meta);
+    free((*tlb)->hands);
+    free(*tlb);
+    *tlb = NULL;
+}
+
+/**
+ * Returns the next FIFO/LRU stamp. When the 32-bit clock runs out, the live
+ * stamps are rebased on the smallest one, which keeps their order.
+ */
+static uint32_t next_stamp(struct tlb *tlb) {
+    if (tlb->clock == UINT32_MAX) {
+        size_t entries = (size_t) tlb->sets * TLB_MAX_WAYS;
+        uint32_t low = UINT32_MAX;
+        for (size_t i = 0; i < entries; i++) {
+            if (tlb->tags[i] >= 0 && tlb->meta[i] < low) {
+                low = tlb->meta[i];
+            }
+        }
+        uint32_t high = 0;
+        for (size_t i = 0; i < entries; i++) {
+            if (tlb->tags[i] >= 0) {
+                tlb->meta[i] -= low;
+                if (tlb->meta[i] > high) {
+                    high = tlb->meta[i];
+                }
+            }
+        }
+        tlb->clock = high;
+    }
+    return ++(tlb->clock);
+}
+
+/**
+ * Looks up a page, updating the set's replacement state on a hit.
+ *
+ * @param tlb A TLB object.
+ * @param page The page to translate.
+ * @return 1 on a hit, 0 on a miss.
+ */
+int tlb_lookup(struct tlb *tlb, int page) {
+    size_t base = (size_t) (page % tlb->sets) * TLB_MAX_WAYS;
+    unsigned mask = match_ways(tlb->tags + base, page);
+    if (!mask) {
+        return 0;
+    }
+    size_t entry = base + (size_t) __builtin_ctz(mask);
+    if (tlb->policy == LRU) {
+        tlb->meta[entry] = next_stamp(tlb);
+    } else if (tlb->policy == NFU) {
+        counter_increment(&(tlb->meta[entry]));
+    } else if (tlb->policy == CLOCK) {
+        tlb->meta[entry] = 1;
+    }
+    return 1;
+}
+
+/**
+ * Picks the way of a full set to replace.
+ */
+static int pick_way(struct tlb *tlb, int set) {
+    uint32_t *meta = tlb->meta + (size_t) set * TLB_MAX_WAYS;
+    if (tlb->policy != CLOCK) {
+        return (int) counter_argmin(meta, (size_t) tlb->ways);
+    }
+    int way = tlb->hands[set];
+    while (meta[way]) {
+        meta[way] = 0;
+        way = (way + 1) % tlb->ways;
+    }
+    tlb->hands[set] = (way + 1) % tlb->ways;
+    return way;
+}
+
+/**
+ * Installs the translation of a page that missed, replacing an entry of its
+ * set if the set is full.
+ *
+ * @param tlb A TLB object.
+ * @param page The page to install.
+ */
+void tlb_fill(struct tlb *tlb, int page) {
+    int set = page % tlb->sets;
+    size_t base = (size_t) set * TLB_MAX_WAYS;
+    unsigned empty = match_ways(tlb->tags + base, EMPTY_TAG);
+    int way = empty ? __builtin_ctz(empty) : pick_way(tlb, set);
+    tlb->tags[base + way] = page;
+    if (tlb->policy == FIFO || tlb->policy == LRU) {
+        tlb->meta[base + way] = next_stamp(tlb);
+    } else {
+        // NFU counts the fill as the first use; CLOCK starts referenced
+        tlb->meta[base + way] = 1;
+    }
+}
+
+/**
+ * Drops the translation of a page, if present.
+ *
+ * @param tlb A TLB object.
+ * @param page The page to drop.
+ */
+void tlb_invalidate(struct tlb *tlb, int page) {
+    size_t base = (size_t) (page % tlb->sets) * TLB_MAX_WAYS;
+    unsigned mask = match_ways(tlb->tags + base, page);
+    if (mask) {
+        tlb->tags[base + __builtin_ctz(mask)] = EMPTY_TAG;
+    }
+}
+
+/**
+ * Evict hook of the page table: a page that lost its frame must not be
+ * translated any more.
+ */
+static void shoot_down(void *context, int page) {
+    struct tlb_hierarchy *h = (struct tlb_hierarchy *) context;
+    for (int level = 0; level < 2; level++) {
+        if (h->levels[level]) {
+            tlb_invalidate(h->levels[level], page);
+        }
+    }
+}
+
+/**
+ * Creates an L1 TLB / L2 TLB / page table hierarchy.
+ *
+ * @param l1 Configuration of the L1 TLB.
+ * @param l2 Configuration of the L2 TLB; sets may be 0 for no L2.
+ * @param pt The page table behind the TLBs; the hierarchy does not own it.
+ * @return A tlb_hierarchy object, or NULL if a configuration is invalid.
+ */
+struct tlb_hierarchy *tlb_hierarchy_create(const struct tlb_config *l1, const struct tlb_config *l2,
+                                           struct page_table *pt) {
+    if (page_table_get_algorithm(pt) == OPT) {
+        printf("OPT buffers references and cannot sit behind a TLB\n");
+        return NULL;
+    }
+    struct tlb_hierarchy *h = (struct tlb_hierarchy *) calloc(1, sizeof(struct tlb_hierarchy));
+    h->pt = pt;
+    h->levels[0] = tlb_create(l1);
+    if (l2->sets > 0) {
+        h->levels[1] = tlb_create(l2);
+    }
+    if (!h->levels[0] || (l2->sets > 0 && !h->levels[1])) {
+        tlb_hierarchy_destroy(&h);
+        return NULL;
+    }
+    page_table_set_evict_hook(pt, shoot_down, h);
+    return h;
+}
+
+/**
+ * Destroys a hierarchy and its TLBs, but not its page table. Sets outside
+ * variable to NULL.
+ *
+ * @param h A tlb_hierarchy object.
+ */
+void tlb_hierarchy_destroy(struct tlb_hierarchy **h) {
+    for (int level = 0; level < 2; level++) {
+        if ((*h)->levels[level]) {
+            tlb_destroy(&((*h)->levels[level]));
+        }
+    }
+    page_table_set_evict_hook((*h)->pt, NULL, NULL);
+    free(*h);
+    *h = NULL;
+}
+
+/**
+ * Simulates instructions accessing pages through the hierarchy.
+ *
+ * @param h A tlb_hierarchy object.
+ * @param pages The pages being accessed.
+ * @param n Number of pages.
+ */
+void tlb_hierarchy_access_pages(struct tlb_hierarchy *h, const int *pages, int n) {
+    struct tlb *l1 = h->levels[0];
+    struct tlb *l2 = h->levels[1];
+    for (int i = 0; i < n; i++) {
+        int page = pages[i];
+        // the page table goes first so evictions shoot down stale entries
+        page_table_access_page(h->pt, page);
+        if (tlb_lookup(l1, page)) {
+            (h->stats[0].hits)++;
+            continue;
+        }
+        (h->stats[0].misses)++;
+        if (l2) {
+            if (tlb_lookup(l2, page)) {
+                (h->stats[1].hits)++;
+            } else {
+                (h->stats[1].misses)++;
+                tlb_fill(l2, page);
+            }
+        }
+        tlb_fill(l1, page);
+    }
+}
+
+/**
+ * Replays a trace through the hierarchy, starting at the reader's current
+ * position.
+ *
+ * @param reader The trace to replay.
+ * @param h A tlb_hierarchy object.
+ * @return 0 on success, -1 if the trace could not be read.
+ */
+int tlb_hierarchy_simulate_trace(struct trace_reader *reader, struct tlb_hierarchy *h) {
+    int chunk[TRACE_CHUNK_SIZE];
+    int n;
+    while ((n = trace_reader_next_chunk(reader, chunk, TRACE_CHUNK_SIZE)) > 0) {
+        tlb_hierarchy_access_pages(h, chunk, n);
+    }
+    return n;
+}
+
+/**
+ * Returns the hit and miss counts of one level.
+ *
+ * @param h A tlb_hierarchy object.
+ * @param level 1 or 2.
+ * @return The counts of that level.
+ */
+struct tlb_stats tlb_hierarchy_stats(const struct tlb_hierarchy *h, int level) {
+    return h->stats[level - 1];
+}
+
+/**
+ * Prints the hits and misses of every TLB level and the page faults.
+ *
+ * @param h A tlb_hierarchy object.
+ * @param out The stream to print to.
+ */
+void tlb_hierarchy_display(const struct tlb_hierarchy *h, FILE *out) {
+    fprintf(out, "==== TLB Hierarchy ====\n");
+    for (int level = 0; level < 2; level++) {
+        const struct tlb *tlb = h->levels[level];
+        if (!tlb) {
+            continue;
+        }
+        long long lookups = h->stats[level].hits + h->stats[level].misses;
+        fprintf(out, "L%d TLB (%d sets x %d ways, %s) : %lld hits, %lld misses (%.2f%% hit rate)\n",
+                level + 1, tlb->sets, tlb->ways, page_table_algorithm_name(tlb->policy),
+                h->stats[level].hits, h->stats[level].misses,
+                lookups > 0 ? 100.0 * (double) h->stats[level].hits / (double) lookups : 0.0);
+    }
+    fprintf(out, "Page Faults : %lld\n", page_table_get_faults(h->pt));
+}
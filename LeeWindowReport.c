@@ -0,0 +1,191 @@
+/*
+ * Online fault-rate reporting.
+ *
+ * Closing a window only copies a few counters per table into the ring; the
+ * text is formatted once a batch is due, into one buffer handed to a single
+ * fwrite. The ring and the text buffer are sized at creation, so reporting
+ * allocates nothing while the trace runs.
+ */
+
+#include <stdlib.h>
+#include "WindowReport.h"
+#include "Simulation.h"
+
+// longest formatted line, header included
+#define REPORT_LINE_SIZE 128
+
+struct window_report {
+    struct page_table **tables;
+    int table_count;
+    long long window;
+    // references into the current window, and over the whole run
+    long long filled;
+    long long time;
+    // faults of every table when the current window opened
+    long long *window_faults;
+    // ring of capacity windows, table_count samples each; count are pending
+    struct window_sample *ring;
+    int capacity;
+    int head;
+    int count;
+    // whether the column header has been written
+    int started;
+    char *text;
+    size_t text_size;
+    FILE *out;
+};
+
+/**
+ * Creates a report over several page tables. The tables stay owned by the
+ * caller and must outlive the report.
+ *
+ * @param tables The page tables to watch.
+ * @param table_count Number of page tables.
+ * @param window References per window, at least 1.
+ * @param capacity Windows held before a batch is written, at least 1.
+ * @param out The stream batches are written to.
+ * @return A report object, or NULL for a bad window or capacity.
+ */
+struct window_report* window_report_create(struct page_table** tables, int table_count, long long window,
+                                           int capacity, FILE* out) {
+    if (window < 1 || capacity < 1 || table_count < 1) {
+        printf("Invalid report window %lld or capacity %d\n", window, capacity);
+        return NULL;
+    }
+    struct window_report *report = (struct window_report *) malloc(sizeof(struct window_report));
+    report->tables = (struct page_table **) malloc(sizeof(struct page_table *) * table_count);
+    report->window_faults = (long long *) malloc(sizeof(long long) * table_count);
+    for (int t = 0; t < table_count; t++) {
+        report->tables[t] = tables[t];
+        report->window_faults[t] = page_table_get_faults(tables[t]);
+    }
+    report->table_count = table_count;
+    report->window = window;
+    report->filled = 0;
+    report->time = 0;
+    report->ring = (struct window_sample *) malloc(sizeof(struct window_sample) * capacity * table_count);
+    report->capacity = capacity;
+    report->head = 0;
+    report->count = 0;
+    report->started = 0;
+    report->text_size = (size_t) (capacity * table_count + 1) * REPORT_LINE_SIZE;
+    report->text = (char *) malloc(report->text_size);
+    report->out = out;
+    return report;
+}
+
+/**
+ * Destroys a report without writing what it still holds. Sets outside
+ * variable to NULL.
+ *
+ * @param report A report object.
+ */
+void window_report_destroy(struct window_report** report) {
+    free((*report)->tables);
+    free((*report)->window_faults);
+    free((*report)->ring);
+    free((*report)->text);
+    free(*report);
+    *report = NULL;
+}
+
+/**
+ * Formats every pending window and writes them with one fwrite.
+ * @return 0 on success, -1 if the write failed
+ */
+static int write_batch(struct window_report *report) {
+    size_t length = 0;
+    if (!report->started) {
+        length += (size_t) snprintf(report->text, REPORT_LINE_SIZE, "%12s %8s %10s %10s %10s %10s %10s\n",
+                                    "time", "policy", "references", "faults", "fault rate", "hit ratio", "resident");
+        report->started = 1;
+    }
+    for (int w = 0; w < report->count; w++) {
+        const struct window_sample *samples =
+                report->ring + (size_t) ((report->head + w) % report->capacity) * report->table_count;
+        for (int t = 0; t < report->table_count; t++) {
+            const struct window_sample *sample = &(samples[t]);
+            double rate = (double) sample->faults / (double) sample->references;
+            length += (size_t) snprintf(report->text + length, REPORT_LINE_SIZE,
+                                        "%12lld %8s %10lld %10lld %10.4f %10.4f %10d\n", sample->time,
+                                        page_table_algorithm_name(page_table_get_algorithm(report->tables[t])),
+                                        sample->references, sample->faults, rate, 1 - rate, sample->resident);
+        }
+    }
+    report->head = (report->head + report->count) % report->capacity;
+    report->count = 0;
+    return fwrite(report->text, 1, length, report->out) == length ? 0 : -1;
+}
+
+/**
+ * Records the current window of every table in the next ring slot and opens a
+ * new window, writing a batch once the ring is full.
+ * @return 0 on success, -1 if a batch could not be written
+ */
+static int close_window(struct window_report *report) {
+    struct window_sample *samples =
+            report->ring + (size_t) ((report->head + report->count) % report->capacity) * report->table_count;
+    for (int t = 0; t < report->table_count; t++) {
+        long long faults = page_table_get_faults(report->tables[t]);
+        samples[t].time = report->time;
+        samples[t].references = report->filled;
+        samples[t].faults = faults - report->window_faults[t];
+        samples[t].resident = page_table_resident_count(report->tables[t]);
+        report->window_faults[t] = faults;
+    }
+    report->filled = 0;
+    report->count++;
+    return report->count == report->capacity ? write_batch(report) : 0;
+}
+
+/**
+ * Replays references through every page table, closing a window each time
+ * one fills. OPT decides references late, so its windows lag behind by the
+ * references it holds back.
+ *
+ * @param report A report object.
+ * @param pages The references to replay.
+ * @param writes 1 for every write and 0 for every read, or NULL if all are reads.
+ * @param n Number of references.
+ * @return 0 on success, -1 if a batch could not be written.
+ */
+int window_report_access_pages(struct window_report* report, const int* pages, const unsigned char* writes,
+                               int n) {
+    int status = 0;
+    int i = 0;
+    while (i < n) {
+        // a full window closes when the next reference arrives, so the last
+        // one is still open for OPT's flush when the trace ends
+        if (report->filled == report->window && close_window(report) != 0) {
+            status = -1;
+        }
+        long long room = report->window - report->filled;
+        int m = n - i < room ? n - i : (int) room;
+        page_tables_access_refs(report->tables, report->table_count, pages + i, writes ? writes + i : NULL, m);
+        report->filled += m;
+        report->time += m;
+        i += m;
+    }
+    return status;
+}
+
+/**
+ * Flushes the page tables, closes the last window and writes every
+ * window not yet written.
+ *
+ * @param report A report object.
+ * @return 0 on success, -1 if a batch could not be written.
+ */
+int window_report_finish(struct window_report* report) {
+    for (int t = 0; t < report->table_count; t++) {
+        page_table_flush(report->tables[t]);
+    }
+    int status = 0;
+    if (report->filled > 0 && close_window(report) != 0) {
+        status = -1;
+    }
+    if ((report->count > 0 || !report->started) && write_batch(report) != 0) {
+        status = -1;
+    }
+    return status;
+}
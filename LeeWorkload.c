@@ -0,0 +1,242 @@
+/*
+ * Synthetic reference strings.
+ *
+ * Zipf ranks are drawn by binary search over the cumulative distribution and
+ * mapped to pages through a random permutation, so popular pages are spread
+ * over the address space instead of crowding the low page numbers.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Workload.h"
+
+static const char *workload_names[] = {
+        "uniform",
+        "zipf",
+        "scan",
+        "loop",
+        "phase",
+        "stride"
+};
+
+// splitmix64, small and good enough for reference strings
+static uint64_t next_random(uint64_t *state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// uniform integer in [0, n)
+static int random_below(uint64_t *state, int n) {
+    return (int) (((next_random(state) >> 32) * (uint64_t) n) >> 32);
+}
+
+// uniform double in [0, 1)
+static double random_unit(uint64_t *state) {
+    return (double) (next_random(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/**
+ * Builds the cumulative Zipf distribution over n ranks.
+ * @return n cumulative probabilities, the last one exactly 1
+ */
+static double *zipf_cdf(int n, double theta) {
+    double *cdf = (double *) malloc(sizeof(double) * n);
+    double sum = 0;
+    for (int i = 0; i < n; i++) {
+        sum += pow(i + 1, -theta);
+        cdf[i] = sum;
+    }
+    for (int i = 0; i < n; i++) {
+        cdf[i] /= sum;
+    }
+    cdf[n - 1] = 1;
+    return cdf;
+}
+
+/**
+ * Draws a Zipf rank, 0 being the most popular.
+ */
+static int zipf_rank(const double *cdf, int n, uint64_t *state) {
+    double u = random_unit(state);
+    int low = 0, high = n - 1;
+    while (low < high) {
+        int mid = low + (high - low) / 2;
+        if (cdf[mid] > u) {
+            high = mid;
+        } else {
+            low = mid + 1;
+        }
+    }
+    return low;
+}
+
+/**
+ * Returns a random permutation of 0 .. n - 1.
+ */
+static int *random_permutation(int n, uint64_t *state) {
+    int *permutation = (int *) malloc(sizeof(int) * n);
+    for (int i = 0; i < n; i++) {
+        permutation[i] = i;
+    }
+    for (int i = n - 1; i > 0; i--) {
+        int j = random_below(state, i + 1);
+        int t = permutation[i];
+        permutation[i] = permutation[j];
+        permutation[j] = t;
+    }
+    return permutation;
+}
+
+/**
+ * Fills in a workload configuration with defaults: a Zipf exponent of 0.99,
+ * a loop over an eighth of the pages, phases of a sixteenth of the pages
+ * lasting a tenth of the trace and a stride of 64 pages.
+ *
+ * @param config The configuration to fill in.
+ * @param kind The reference pattern.
+ * @param page_count Number of pages.
+ * @param length Number of references.
+ */
+void workload_config_init(struct workload_config* config, enum workload_kind kind, int page_count, long long length) {
+    config->kind = kind;
+    config->page_count = page_count;
+    config->length = length;
+    config->zipf_theta = 0.99;
+    config->loop_pages = page_count / 8 > 0 ? page_count / 8 : 1;
+    config->phase_pages = page_count / 16 > 0 ? page_count / 16 : 1;
+    config->phase_length = length / 10 > 0 ? length / 10 : 1;
+    config->stride = page_count > 64 ? 64 : 1;
+    config->seed = 1;
+}
+
+/**
+ * Generates a reference string.
+ *
+ * @param config The workload to generate.
+ * @return config->length page numbers below page_count, to be freed by the
+ * caller, or NULL for a bad configuration.
+ */
+int* workload_generate(const struct workload_config* config) {
+    int page_count = config->page_count;
+    long long length = config->length;
+    if (page_count < 1 || length < 0 || (unsigned) config->kind >= WORKLOAD_KIND_COUNT ||
+        config->zipf_theta <= 0 || config->loop_pages < 1 || config->loop_pages > page_count ||
+        config->phase_pages < 1 || config->phase_pages > page_count || config->phase_length < 1 ||
+        config->stride < 1 || config->stride > page_count) {
+        printf("Invalid workload configuration\n");
+        return NULL;
+    }
+
+    int *pages = (int *) malloc(sizeof(int) * (length > 0 ? length : 1));
+    uint64_t state = config->seed;
+    switch (config->kind) {
+        case UNIFORM_WORKLOAD:
+            for (long long i = 0; i < length; i++) {
+                pages[i] = random_below(&state, page_count);
+            }
+            break;
+        case ZIPF_WORKLOAD: {
+            double *cdf = zipf_cdf(page_count, config->zipf_theta);
+            int *permutation = random_permutation(page_count, &state);
+            for (long long i = 0; i < length; i++) {
+                pages[i] = permutation[zipf_rank(cdf, page_count, &state)];
+            }
+            free(cdf);
+            free(permutation);
+            break;
+        }
+        case SCAN_WORKLOAD:
+            for (long long i = 0; i < length; i++) {
+                pages[i] = (int) (i % page_count);
+            }
+            break;
+        case LOOP_WORKLOAD:
+            for (long long i = 0; i < length; i++) {
+                pages[i] = (int) (i % config->loop_pages);
+            }
+            break;
+        case PHASE_WORKLOAD: {
+            // every phase moves the working set to a random base
+            double *cdf = zipf_cdf(config->phase_pages, config->zipf_theta);
+            int *permutation = random_permutation(config->phase_pages, &state);
+            int base = 0;
+            for (long long i = 0; i < length; i++) {
+                if (i % config->phase_length == 0) {
+                    base = random_below(&state, page_count);
+                }
+                pages[i] = (base + permutation[zipf_rank(cdf, config->phase_pages, &state)]) % page_count;
+            }
+            free(cdf);
+            free(permutation);
+            break;
+        }
+        case STRIDE_WORKLOAD: {
+            int count = (page_count - 1) / config->stride + 1;
+            for (long long i = 0; i < length; i++) {
+                pages[i] = random_below(&state, count) * config->stride;
+            }
+            break;
+        }
+        default:
+            break;
+    }
+    return pages;
+}
+
+/**
+ * Writes a generated reference string as a text trace that pra can replay.
+ *
+ * @param config The workload to generate.
+ * @param frame_count The frame count recorded in the trace header.
+ * @param filename The file to write.
+ * @return 0 on success, -1 on error.
+ */
+int workload_write_trace(const struct workload_config* config, int frame_count, char* filename) {
+    int *pages = workload_generate(config);
+    if (!pages) {
+        return -1;
+    }
+    FILE *out = fopen(filename, "w");
+    if (!out) {
+        printf("Cannot open file %s\n", filename);
+        free(pages);
+        return -1;
+    }
+    fprintf(out, "%d\n%d\n%lld\n", config->page_count, frame_count, config->length);
+    for (long long i = 0; i < config->length; i++) {
+        fprintf(out, "%d\n", pages[i]);
+    }
+    free(pages);
+    return fclose(out) == 0 ? 0 : -1;
+}
+
+/**
+ * Returns the name of a reference pattern.
+ *
+ * @param kind A reference pattern.
+ * @return The name of the pattern, e.g. "zipf".
+ */
+const char* workload_name(enum workload_kind kind) {
+    return workload_names[kind];
+}
+
+/**
+ * Looks up a reference pattern by name.
+ *
+ * @param name The name of the pattern.
+ * @param kind Receives the pattern.
+ * @return 0 on success, -1 for an unknown name.
+ */
+int workload_from_name(const char* name, enum workload_kind* kind) {
+    for (int i = 0; i < WORKLOAD_KIND_COUNT; i++) {
+        if (strcmp(name, workload_names[i]) == 0) {
+            *kind = (enum workload_kind) i;
+            return 0;
+        }
+    }
+    return -1;
+}
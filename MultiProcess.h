@@ -0,0 +1,105 @@
+/**
+ * Multi-process simulation: references tagged with a pid are replayed over one
+ * shared pool of frames, with either local or global replacement.
+ *
+ * @author Lee
+ * @version 1.0
+ */
+
+#ifndef MULTIPROCESS_H
+#define MULTIPROCESS_H
+
+#include <stdio.h>
+#include "DataLoader.h"
+#include "PageTable.h"
+
+//enumeration to represent where a faulting process finds its victim.
+enum replacement_scope {
+    // every process has its own page table and a fixed quota of frames
+    LOCAL_REPLACEMENT=0,
+    // one page table over the whole pool; a fault may evict any process's page
+    GLOBAL_REPLACEMENT
+};
+
+//structs
+struct process_stats {
+    int pid;
+    long long references;
+    long long faults;
+    // frames holding pages of this process
+    int resident;
+};
+
+//forward declarations for structs
+struct multi_process;
+
+/**
+ * Creates a multi-process simulation. Page tables use the sparse backend, so
+ * memory grows with the pages actually touched rather than with the number of
+ * processes times page_count.
+ *
+ * @param page_count Number of pages of every process.
+ * @param frame_count Size of the shared frame pool.
+ * @param algorithm Page replacement algorithm. OPT is not supported.
+ * @param scope Local or global replacement.
+ * @param quota Frames given to every process under local replacement.
+ * @return A multi_process object, or NULL if the arguments are invalid.
+ */
+struct multi_process* multi_process_create(int page_count, int frame_count, enum replacement_algorithm algorithm,
+                                           enum replacement_scope scope, int quota);
+
+/**
+ * Destroys a multi-process simulation. Sets outside variable to NULL.
+ *
+ * @param mp A multi_process object.
+ */
+void multi_process_destroy(struct multi_process** mp);
+
+/**
+ * Replays references tagged with pids. Runs of references by the same process
+ * go to its page table as one batch.
+ *
+ * @param mp A multi_process object.
+ * @param pids The pid of every reference.
+ * @param pages The pages being accessed.
+ * @param n Number of references.
+ * @return 0 on success, -1 if a new process does not fit in the frame pool.
+ */
+int multi_process_access_pages(struct multi_process* mp, const int* pids, const int* pages, int n);
+
+/**
+ * Replays a trace, starting at the reader's current position.
+ *
+ * @param reader The trace to replay.
+ * @param mp A multi_process object.
+ * @return 0 on success, -1 on error.
+ */
+int multi_process_simulate_trace(struct trace_reader* reader, struct multi_process* mp);
+
+/**
+ * Returns the number of processes seen so far.
+ *
+ * @param mp A multi_process object.
+ * @return Number of processes.
+ */
+int multi_process_count(const struct multi_process* mp);
+
+/**
+ * Returns the statistics of a process, in order of first appearance.
+ *
+ * @param mp A multi_process object.
+ * @param index Index of the process, below multi_process_count.
+ * @return The statistics of the process.
+ */
+const struct process_stats* multi_process_stats(const struct multi_process* mp, int index);
+
+/**
+ * Prints the references, faults and resident frames of every process, by
+ * pid, followed by the totals.
+ *
+ * @param mp A multi_process object.
+ * @param out The stream to print to.
+ */
+void multi_process_display(const struct multi_process* mp, FILE* out);
+
+#endif
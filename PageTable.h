@@ -15,12 +15,116 @@
 enum replacement_algorithm {
     FIFO=0,
     LRU,
-    MFU
+    MFU,
+    LFU,
+    // second chance over the REFERENCED bit
+    CLOCK,
+    // second chance over the (REFERENCED, DIRTY) pair, preferring clean victims
+    ENHANCED_SECOND_CHANCE,
+    CLOCK_PRO,
+    // scan-resistant policies with ghost lists bounded by frame_count
+    ARC,
+    TWO_QUEUE,
+    // Belady's optimal policy; needs the future, so references are buffered
+    OPT,
+    // not frequently used: evicts the frame with the fewest accesses, found by a vector scan
+    NFU,
+    // NFU with shift-register counters aged every aging_tick references
+    AGING,
+    // working set: pages unused for ws_window references give up their frames
+    WORKING_SET,
+    // WSClock: a clock over frames that evicts clean pages older than ws_window
+    WSCLOCK
+};
+
+//enumeration to represent how page table entries are stored.
+enum page_table_backend {
+    // one entry per page, allocated up front
+    DENSE_TABLE=0,
+    // hash map holding only the pages touched so far, for huge sparse address spaces
+    SPARSE_TABLE
+};
+
+//options for creating a page table
+struct page_table_config {
+    int page_count;
+    int frame_count;
+    enum replacement_algorithm algorithm;
+    enum page_table_backend backend;
+    int verbose;
+    // OPT only: references of lookahead, 0 to see the whole trace
+    int opt_lookahead;
+    // AGING only: counter width (8, 16 or 32) and references per tick, 0 for frame_count
+    int aging_bits;
+    int aging_tick;
+    // WORKING_SET and WSCLOCK only: window tau in references, 0 for frame_count,
+    // and how often to sample the resident set size, 0 for never
+    long long ws_window;
+    int sample_interval;
+    // pages read ahead into free frames when a fault follows the previous
+    // page's, 0 for none; OPT never reads ahead
+    int readahead;
+    // dirty pages gathered before they are written back, at least 1;
+    // consecutive pages in a batch share one write
+    int writeback_batch;
+    // bytes per page, for the I/O estimates
+    int page_size;
+};
+
+//one point of the resident set size curve
+struct page_table_sample {
+    // references so far
+    long long time;
+    long long faults;
+    // frames in use
+    int resident;
+};
+
+//estimated paging I/O
+struct page_table_io {
+    // a fault reads its page and the pages read ahead with it in one operation
+    long long read_ops;
+    long long pages_read;
+    long long bytes_read;
+    // pages read ahead, and how many of them were referenced before eviction
+    long long readahead_pages;
+    long long readahead_hits;
+    // write-back operations after clustering, and the dirty pages written
+    long long write_ops;
+    long long pages_written;
+    long long bytes_written;
+};
+
+//number of power-of-two buckets in a latency histogram
+#define PAGE_TABLE_LATENCY_BUCKETS 32
+
+//counters and latency histograms, collected when built with PRA_STATS
+struct page_table_stats {
+    long long references;
+    long long hits;
+    long long faults;
+    // faults on pages never loaded before, and all others
+    long long cold_faults;
+    long long capacity_faults;
+    long long evictions;
+    // evicted dirty pages, plus WSClock's write-backs of old dirty pages
+    long long dirty_writebacks;
+    // frames examined by the scanning policies (the clocks, NFU and AGING)
+    // while looking for a victim
+    long long victim_steps;
+    /*
+     * access_latency[b] counts references that took between 2^b and 2^(b+1)
+     * ticks of the cycle counter (nanoseconds where there is none); a batch
+     * counts each of its references at the batch's average. fault_latency
+     * does the same for the policy's fault handling.
+     */
+    long long access_latency[PAGE_TABLE_LATENCY_BUCKETS];
+    long long fault_latency[PAGE_TABLE_LATENCY_BUCKETS];
 };
 
 //forward declarations for structs
-struct page_table_entry;
 struct page_table;
+struct trace_mark;
 
 /**
  * Creates a new page table object. Returns a pointer to created page table.
@@ -29,10 +133,70 @@ struct page_table;
  * @param frame_count Numbers of frames.
  * @param algorithm Page replacement algorithm
  * @param verbose Enables showing verbose table contents.
- * @return A page table object.
+ * @return A page table object, or NULL for a bad configuration.
  */
 struct page_table* page_table_create(int page_count, int frame_count, enum replacement_algorithm algorithm, int verbose);
 
+/**
+ * Fills in a page table configuration with defaults: a dense table without
+ * verbose output, OPT looking ahead over the whole trace, 8-bit AGING
+ * counters ticking every frame_count references, a working-set window of
+ * frame_count references without sampling, no readahead and every dirty page
+ * written back on its own as a 4096-byte page.
+ *
+ * @param config The configuration to initialize.
+ * @param page_count Number of pages.
+ * @param frame_count Numbers of frames.
+ * @param algorithm Page replacement algorithm
+ */
+void page_table_config_init(struct page_table_config *config, int page_count, int frame_count,
+                            enum replacement_algorithm algorithm);
+
+/**
+ * Creates a new page table object from a configuration. This is how a sparse
+ * backend is selected. The table and all of its fixed-size state share one
+ * cache-aligned allocation.
+ *
+ * @param config The configuration of the table.
+ * @return A page table object, or NULL if the algorithm is unknown or the
+ * page or frame count is below 1.
+ */
+struct page_table* page_table_create_config(const struct page_table_config *config);
+
+/**
+ * Returns the size of the single cache-aligned block a page table for a
+ * configuration is created in. Hash maps for sparse entries and some policies,
+ * OPT's reference buffer and the resident set size series grow with the trace
+ * and live on the heap instead.
+ *
+ * @param config The configuration of the table.
+ * @return The size in bytes, a multiple of 64, or 0 if the algorithm is unknown
+ * or the page or frame count is below 1.
+ */
+size_t page_table_arena_size(const struct page_table_config *config);
+
+/**
+ * Creates a new page table object from a configuration in memory the caller
+ * owns, so a batch of tables can share one allocation. The memory must stay
+ * alive until the table is destroyed; destroying the table does not free it.
+ *
+ * @param config The configuration of the table.
+ * @param memory A 64-byte aligned block.
+ * @param size The size of the block, at least page_table_arena_size(config).
+ * @return A page table object at the start of memory, or NULL for an unknown
+ * algorithm, a bad configuration or a block that does not fit.
+ */
+struct page_table* page_table_create_in(const struct page_table_config *config, void* memory, size_t size);
+
+/**
+ * Empties a page table for another run with the same configuration, as if it
+ * was just created, without allocating or freeing memory. The eviction hook
+ * stays installed.
+ *
+ * @param pt A page table object.
+ */
+void page_table_reset(struct page_table* pt);
+
 /**
  * Destorys an existing page table object. Sets outside variable to NULL.
  *
@@ -40,6 +204,47 @@ struct page_table* page_table_create(int page_count, int frame_count, enum repla
  */
 void page_table_destroy(struct page_table** pt);
 
+/**
+ * Writes the complete state of a page table to a file: page entries, frames,
+ * policy structures, the fault count, statistics and the resident set size
+ * series, with the position of the trace being replayed. Snapshots are raw
+ * memory images and only restore on the build that wrote them.
+ *
+ * @param pt A page table object.
+ * @param mark Where the trace replaying into the table is, or NULL for none.
+ * @param filename The snapshot file to write.
+ * @return 0 on success, -1 for an OPT table or on error.
+ */
+int page_table_snapshot(const struct page_table* pt, const struct trace_mark* mark, char* filename);
+
+/**
+ * Restores a page table from a snapshot written by the same build. The file
+ * is mapped copy-on-write and the table works in place inside the mapping,
+ * so untouched page entries are only read from disk when first used. The
+ * eviction hook is not restored.
+ *
+ * @param filename The snapshot file.
+ * @param mark Receives where the trace replaying into the table was, position
+ * -1 if the snapshot was not taken mid-trace, or NULL.
+ * @return A page table object, or NULL if the snapshot cannot be restored.
+ */
+struct page_table* page_table_restore(char* filename, struct trace_mark* mark);
+
+/**
+ * Starts a what-if run from a warmed-up table: creates a table for another
+ * configuration, typically another policy, holding the same resident pages
+ * with the same dirty bits, fault count and I/O, pending write-backs
+ * included. The resident pages are replayed into the new policy in frame
+ * order, so it starts from the same memory contents but builds its own
+ * history of them.
+ *
+ * @param pt A page table object to fork from; it is not changed.
+ * @param config The configuration of the new table, with the same page and
+ * frame counts as pt.
+ * @return A page table object, or NULL if the configuration does not fit.
+ */
+struct page_table* page_table_fork(const struct page_table* pt, const struct page_table_config* config);
+
 /**
  * Simulates an instruction accessing a particular page in the page table.
  *
@@ -49,18 +254,163 @@ void page_table_destroy(struct page_table** pt);
 void page_table_access_page(struct page_table *pt, int page);
 
 /**
- * Displays page table replacement algorithm, number of page faults, and the
- * current contents of the page table.
+ * Replays any references the table is still holding back. OPT buffers
+ * references until it has seen enough of the future, so its fault count is
+ * only complete after a flush; other policies never buffer. Dirty pages
+ * still queued for write-back are written.
+ *
+ * @param pt A page table object.
+ */
+void page_table_flush(struct page_table *pt);
+
+/**
+ * Returns the number of page faults seen so far.
+ *
+ * @param pt A page table object.
+ * @return Number of page faults.
+ */
+long long page_table_get_faults(const struct page_table *pt);
+
+/**
+ * Returns the statistics collected so far. OPT holds references back until
+ * page_table_flush, so flush first for complete counts.
+ *
+ * @param pt A page table object.
+ * @param stats Receives the statistics; zeroed if they are not collected.
+ * @return 0 on success, -1 if the build does not define PRA_STATS.
+ */
+int page_table_get_stats(const struct page_table *pt, struct page_table_stats *stats);
+
+/**
+ * Prints the statistics and the non-empty latency buckets.
+ *
+ * @param pt A page table object.
+ * @param out The stream to print to.
+ */
+void page_table_display_stats(const struct page_table *pt, FILE *out);
+
+/**
+ * Returns the paging I/O estimated so far: a read for every fault, carrying
+ * the pages read ahead with it, and the clustered write-backs of dirty pages.
+ * Flush first so queued write-backs are counted as written.
+ *
+ * @param pt A page table object.
+ * @param io Receives the estimates.
+ */
+void page_table_get_io(const struct page_table *pt, struct page_table_io *io);
+
+/**
+ * Prints the I/O estimates.
+ *
+ * @param pt A page table object.
+ * @param out The stream to print to.
+ */
+void page_table_display_io(const struct page_table *pt, FILE *out);
+
+/**
+ * Returns the resident set size curve recorded so far. Only WORKING_SET and
+ * WSCLOCK record one, when created with a sample_interval.
+ *
+ * @param pt A page table object.
+ * @param count Set to the number of samples.
+ * @return The samples in time order, owned by the page table.
+ */
+const struct page_table_sample *page_table_series(const struct page_table *pt, int *count);
+
+/**
+ * Registers a function called with every page that is evicted from its frame.
+ *
+ * @param pt A page table object.
+ * @param hook The function to call, or NULL to remove it.
+ * @param context Passed to the hook as its first argument.
+ */
+void page_table_set_evict_hook(struct page_table *pt, void (*hook)(void *context, int page), void *context);
+
+/**
+ * Returns the number of frames holding a page.
+ *
+ * @param pt A page table object.
+ * @return Number of resident pages.
+ */
+int page_table_resident_count(const struct page_table *pt);
+
+/**
+ * Returns the replacement algorithm of a page table.
+ *
+ * @param pt A page table object.
+ * @return The replacement algorithm.
+ */
+enum replacement_algorithm page_table_get_algorithm(const struct page_table *pt);
+
+/**
+ * Returns the number of pages a page table keeps track of.
+ *
+ * @param pt A page table object.
+ * @return Number of pages.
+ */
+int page_table_get_page_count(const struct page_table *pt);
+
+/**
+ * Returns the number of frames of a page table.
+ *
+ * @param pt A page table object.
+ * @return Number of frames.
+ */
+int page_table_get_frame_count(const struct page_table *pt);
+
+/**
+ * Returns the name of a replacement algorithm.
+ *
+ * @param algorithm A replacement algorithm.
+ * @return The name of the algorithm, e.g. "LRU".
+ */
+const char *page_table_algorithm_name(enum replacement_algorithm algorithm);
+
+/**
+ * Looks up a replacement algorithm by name, ignoring case.
+ *
+ * @param name The name of the algorithm, as page_table_algorithm_name gives it.
+ * @param algorithm Receives the algorithm.
+ * @return 0 on success, -1 for an unknown name.
+ */
+int page_table_algorithm_from_name(const char *name, enum replacement_algorithm *algorithm);
+
+/**
+ * Simulates a run of instructions accessing pages, with the same result as
+ * calling page_table_access_page for each of them but dispatching on the
+ * replacement algorithm once per batch.
+ *
+ * @param pt A page table object.
+ * @param pages The pages being accessed.
+ * @param n Number of pages.
+ */
+void page_table_access_pages(struct page_table *pt, const int *pages, size_t n);
+
+/**
+ * Simulates an instruction writing to a particular page: the page is accessed
+ * and its DIRTY bit is set.
+ *
+ * @param pt A page table object.
+ * @param page The page being written.
+ */
+void page_table_write_page(struct page_table *pt, int page);
+
+/**
+ * Displays page table replacement algorithm and number of page faults.
+ * page_table_display_contents lists the pages.
  *
  * @param pt A page table object.
  */
 void page_table_display(struct page_table* pt);
 
 /**
- * Displays the current contents of the page table.
+ * Displays the current contents of the page table. Rows are formatted into a
+ * buffer and written in large blocks, since a dense table has a row for every
+ * page.
  *
  * @param pt A page table object.
+ * @param out The stream to print to.
  */
-void page_table_display_contents(struct page_table *pt);
+void page_table_display_contents(const struct page_table *pt, FILE *out);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,70 @@
+/**
+ * Approximate fault curves from spatially sampled traces (SHARDS). A page is
+ * kept with probability rate by hashing its number, so every reference to a
+ * kept page survives and reuse patterns are preserved; frame counts shrink
+ * by the same rate. Several hash seeds give independent samples whose spread
+ * serves as an error bar.
+ *
+ * @author Lee
+ * @version 1.0
+ */
+
+#ifndef SHARDS_H
+#define SHARDS_H
+
+#include <stdio.h>
+#include "PageTable.h"
+
+//structs
+struct shards_result {
+    int min_frames;
+    int max_frames;
+    int policy_count;
+    enum replacement_algorithm *policies;
+    // fraction of pages sampled, and number of independent samples
+    double rate;
+    int seed_count;
+    // references in the full trace, and the mean number kept per sample
+    long long length;
+    double sampled_length;
+    // estimated faults of the full trace over all samples, at
+    // [(frame_count - min_frames) * policy_count + policy]
+    double *mean_faults;
+    double *stddev_faults;
+};
+
+/**
+ * Estimates fault curves from sampled traces. Every sample keeps the pages a
+ * seeded hash puts below rate and replays them with frame_count * rate
+ * frames on the sparse backend; its fault count is scaled back up by
+ * 1 / rate. All samples share one pass over the trace.
+ *
+ * @param filename The trace to replay.
+ * @param policies The policies to evaluate.
+ * @param policy_count Number of policies.
+ * @param min_frames Smallest frame count, at least 1.
+ * @param max_frames Largest frame count.
+ * @param rate Fraction of pages to sample, in (0, 1].
+ * @param seed_count Number of independent samples, at least 1.
+ * @return The estimated fault curves, or NULL if the trace could not be read.
+ */
+struct shards_result* shards_run(char* filename, const enum replacement_algorithm* policies, int policy_count,
+                                 int min_frames, int max_frames, double rate, int seed_count);
+
+/**
+ * Destroys a sampling result. Sets outside variable to NULL.
+ *
+ * @param result A sampling result.
+ */
+void shards_destroy(struct shards_result** result);
+
+/**
+ * Prints the estimated fault curves with one row per frame count and, for
+ * every policy, the mean estimate and its standard deviation over samples.
+ *
+ * @param result A sampling result.
+ * @param out The stream to print to.
+ */
+void shards_display(const struct shards_result* result, FILE* out);
+
+#endif
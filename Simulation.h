@@ -0,0 +1,68 @@
+/**
+ * Drivers that replay a trace through one or more page tables.
+ *
+ * @author Lee
+ * @version 1.0
+ */
+
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include "DataLoader.h"
+#include "PageTable.h"
+
+/**
+ * Advances several page tables in lockstep over the same references. Each
+ * table consumes the whole batch before the next one starts, so the batch
+ * stays in cache while every policy replays it.
+ *
+ * @param tables The page tables to drive.
+ * @param table_count Number of page tables.
+ * @param pages The references to replay.
+ * @param n Number of references.
+ */
+void page_tables_access_pages(struct page_table** tables, int table_count, const int* pages, int n);
+
+/**
+ * Advances several page tables in lockstep over references some of which are
+ * writes. Runs of reads go through the batch loop and every write through
+ * page_table_write_page, so the DIRTY bits are what replaying the references
+ * one at a time would give.
+ *
+ * @param tables The page tables to drive.
+ * @param table_count Number of page tables.
+ * @param pages The references to replay.
+ * @param writes 1 for every write and 0 for every read, or NULL if all are reads.
+ * @param n Number of references.
+ */
+void page_tables_access_refs(struct page_table** tables, int table_count, const int* pages,
+                             const unsigned char* writes, int n);
+
+/**
+ * Replays a trace through several page tables, decoding every chunk once for
+ * all of them. Writes in the trace set DIRTY bits. Reading starts at the
+ * reader's current position.
+ *
+ * @param reader The trace to replay.
+ * @param tables The page tables to drive.
+ * @param table_count Number of page tables.
+ * @return 0 on success, -1 if the trace could not be read.
+ */
+int simulate_trace(struct trace_reader* reader, struct page_table** tables, int table_count);
+
+/**
+ * Replays the next references of a trace through several page tables without
+ * flushing them, so they can be snapshotted mid-trace and resumed later.
+ * Reading starts at the reader's current position.
+ *
+ * @param reader The trace to replay.
+ * @param tables The page tables to drive.
+ * @param table_count Number of page tables.
+ * @param references The most references to replay.
+ * @return Number of references replayed, fewer only at the end of the trace,
+ * or -1 if the trace could not be read.
+ */
+long long simulate_trace_prefix(struct trace_reader* reader, struct page_table** tables, int table_count,
+                                long long references);
+
+#endif
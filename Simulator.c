@@ -5,47 +5,792 @@
  * @author Acuna
  * @version 1.0
  */
+#include <getopt.h>
+#include <limits.h>
+#include <math.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include "DataLoader.h"
 #include "PageTable.h"
+#include "Simulation.h"
+#include "Sweep.h"
+#include "Shards.h"
+#include "StackDistance.h"
+#include "MultiProcess.h"
+#include "Tlb.h"
+#include "WindowReport.h"
 
-int main(int argc, char* argv[]) {
-//    char* filename = argv[2];
-    char* filename = "/Users/jolee211/CLionProjects/PageReplacementAlgorithms/data-2.txt";
+//windows the default mode holds before writing a batch
+#define REPORT_CAPACITY 256
+
+//most policies the default mode runs at once
+#define MAX_POLICIES 32
+
+/**
+ * Checks the frame count a trace header gives the modes that take it as is.
+ * @return 0 if it is at least 1, -1 otherwise
+ */
+static int check_trace_frames(const struct trace_header* header) {
+    if (header->frame_count < 1) {
+        printf("Invalid frame count %d\n", header->frame_count);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Computes the LRU miss-ratio curve of a trace in one pass.
+ *
+ * Usage: pra --mrc <trace> [min frames] [max frames]
+ */
+static int run_mrc(int argc, char* argv[]) {
+    if (argc < 3) {
+        printf("Usage: %s --mrc <trace> [min frames] [max frames]\n", argv[0]);
+        return 1;
+    }
+    struct trace_reader* reader = trace_reader_open(argv[2]);
+    if (!reader) {
+        return 1;
+    }
+    const struct trace_header* header = trace_reader_header(reader);
+    struct stack_distance* sd = stack_distance_create(header->page_count);
+    int status = stack_distance_simulate_trace(reader, sd) == 0 ? 0 : 1;
+    if (status == 0) {
+        int min_frames = argc > 3 ? atoi(argv[3]) : 1;
+        int max_frames = argc > 4 ? atoi(argv[4]) : header->page_count;
+        stack_distance_display(sd, min_frames, max_frames, stdout);
+    }
+    stack_distance_destroy(&sd);
+    trace_reader_close(&reader);
+    return status;
+}
+
+/**
+ * Runs the working-set policies over a trace and prints their fault counts and
+ * resident set sizes over time.
+ *
+ * Usage: pra --ws <trace> <window> [sample interval]
+ */
+static int run_working_set(int argc, char* argv[]) {
+    if (argc < 4) {
+        printf("Usage: %s --ws <trace> <window> [sample interval]\n", argv[0]);
+        return 1;
+    }
+    struct trace_reader* reader = trace_reader_open(argv[2]);
+    if (!reader) {
+        return 1;
+    }
+    const struct trace_header* header = trace_reader_header(reader);
+    enum replacement_algorithm policies[] = {WORKING_SET, WSCLOCK};
+    struct page_table* tables[2] = {NULL, NULL};
+    int status = check_trace_frames(header) == 0 ? 0 : 1;
+    for (int i = 0; i < 2 && status == 0; i++) {
+        struct page_table_config config;
+        page_table_config_init(&config, header->page_count, header->frame_count, policies[i]);
+        config.ws_window = atoll(argv[3]);
+        config.sample_interval = argc > 4 ? atoi(argv[4]) : 1000;
+        tables[i] = page_table_create_config(&config);
+        status = tables[i] ? 0 : 1;
+    }
+    if (status == 0) {
+        status = simulate_trace(reader, tables, 2) == 0 ? 0 : 1;
+    }
+    if (status == 0) {
+        int ws_count;
+        int wsclock_count;
+        const struct page_table_sample* ws = page_table_series(tables[0], &ws_count);
+        const struct page_table_sample* wsclock = page_table_series(tables[1], &wsclock_count);
+        printf("%12s %12s %12s %12s %12s\n", "time", "WS faults", "WS rss", "WSClock flt", "WSClock rss");
+        // both tables saw the same references, so their samples line up
+        for (int i = 0; i < ws_count && i < wsclock_count; i++) {
+            printf("%12lld %12lld %12d %12lld %12d\n", ws[i].time, ws[i].faults, ws[i].resident,
+                   wsclock[i].faults, wsclock[i].resident);
+        }
+        for (int i = 0; i < 2; i++) {
+            printf("%s: %lld faults, %d resident at the end\n", page_table_algorithm_name(policies[i]),
+                   page_table_get_faults(tables[i]), page_table_resident_count(tables[i]));
+        }
+    }
+    for (int i = 0; i < 2; i++) {
+        if (tables[i]) {
+            page_table_destroy(&(tables[i]));
+        }
+    }
+    trace_reader_close(&reader);
+    return status;
+}
+
+/**
+ * Replays a pid:page trace over the trace's frame pool with LRU, either with
+ * a per-process quota or with global replacement, and prints every process.
+ *
+ * Usage: pra --mp <trace> local <quota> | pra --mp <trace> global
+ */
+static int run_multi_process(int argc, char* argv[]) {
+    int local = argc > 4 && strcmp(argv[3], "local") == 0;
+    if (!local && !(argc > 3 && strcmp(argv[3], "global") == 0)) {
+        printf("Usage: %s --mp <trace> local <quota> | %s --mp <trace> global\n", argv[0], argv[0]);
+        return 1;
+    }
+    struct trace_reader* reader = trace_reader_open(argv[2]);
+    if (!reader) {
+        return 1;
+    }
+    const struct trace_header* header = trace_reader_header(reader);
+    if (check_trace_frames(header) != 0) {
+        trace_reader_close(&reader);
+        return 1;
+    }
+    struct multi_process* mp = multi_process_create(header->page_count, header->frame_count, LRU,
+                                                    local ? LOCAL_REPLACEMENT : GLOBAL_REPLACEMENT,
+                                                    local ? atoi(argv[4]) : 0);
+    int status = 1;
+    if (mp) {
+        status = multi_process_simulate_trace(reader, mp) == 0 ? 0 : 1;
+        multi_process_display(mp, stdout);
+        multi_process_destroy(&mp);
+    }
+    trace_reader_close(&reader);
+    return status;
+}
 
-    struct test_scenario* data = load_test_data(filename);
-    struct page_table* pt_fifo = page_table_create(data->page_count, data->frame_count, FIFO, 1);
-    struct page_table* pt_lru = page_table_create(data->page_count, data->frame_count, LRU, 1);
-    struct page_table* pt_mfu = page_table_create(data->page_count, data->frame_count, MFU, 1);
+/**
+ * Replays a trace through LRU L1 and L2 TLBs in front of an LRU page table and
+ * prints TLB hits and misses next to the page faults.
+ *
+ * Usage: pra --tlb <trace> <l1 sets> <l1 ways> [l2 sets l2 ways]
+ */
+static int run_tlb(int argc, char* argv[]) {
+    if (argc < 5) {
+        printf("Usage: %s --tlb <trace> <l1 sets> <l1 ways> [l2 sets l2 ways]\n", argv[0]);
+        return 1;
+    }
+    struct tlb_config l1 = {atoi(argv[3]), atoi(argv[4]), LRU};
+    struct tlb_config l2 = {argc > 6 ? atoi(argv[5]) : 0, argc > 6 ? atoi(argv[6]) : 0, LRU};
+    struct trace_reader* reader = trace_reader_open(argv[2]);
+    if (!reader) {
+        return 1;
+    }
+    const struct trace_header* header = trace_reader_header(reader);
+    struct page_table* pt = check_trace_frames(header) == 0 ?
+                            page_table_create(header->page_count, header->frame_count, LRU, 0) : NULL;
+    if (!pt) {
+        trace_reader_close(&reader);
+        return 1;
+    }
+    struct tlb_hierarchy* h = tlb_hierarchy_create(&l1, &l2, pt);
+    int status = 1;
+    if (h) {
+        status = tlb_hierarchy_simulate_trace(reader, h) == 0 ? 0 : 1;
+        tlb_hierarchy_display(h, stdout);
+        tlb_hierarchy_destroy(&h);
+    }
+    page_table_destroy(&pt);
+    trace_reader_close(&reader);
+    return status;
+}
 
-    //simulate page requests: fifo
-    for (int i = 0; i < data->refstr_len; i++) {
-        page_table_access_page(pt_fifo, data->refstr[i]);
-        //page_table_display_contents(pt_fifo);
+/**
+ * Replays the start of a trace through one policy with the trace's frame
+ * count and saves the table, with the trace position, to a snapshot.
+ *
+ * Usage: pra --snapshot <trace> <policy> <references> <snapshot>
+ */
+static int run_snapshot(int argc, char* argv[]) {
+    if (argc < 6) {
+        printf("Usage: %s --snapshot <trace> <policy> <references> <snapshot>\n", argv[0]);
+        return 1;
+    }
+    enum replacement_algorithm policy;
+    if (page_table_algorithm_from_name(argv[3], &policy) != 0) {
+        printf("Unknown policy %s\n", argv[3]);
+        return 1;
+    }
+    struct trace_reader* reader = trace_reader_open(argv[2]);
+    if (!reader) {
+        return 1;
+    }
+    const struct trace_header* header = trace_reader_header(reader);
+    struct page_table* pt = check_trace_frames(header) == 0 ?
+                            page_table_create(header->page_count, header->frame_count, policy, 0) : NULL;
+    if (!pt) {
+        trace_reader_close(&reader);
+        return 1;
+    }
+    int status = 1;
+    long long replayed = simulate_trace_prefix(reader, &pt, 1, atoll(argv[4]));
+    if (replayed >= 0) {
+        struct trace_mark mark;
+        trace_reader_tell(reader, &mark);
+        status = page_table_snapshot(pt, &mark, argv[5]) == 0 ? 0 : 1;
+        if (status == 0) {
+            printf("%s: %lld faults after %lld references, saved to %s\n", page_table_algorithm_name(policy),
+                   page_table_get_faults(pt), replayed, argv[5]);
+        }
     }
-    page_table_display(pt_fifo);
+    page_table_destroy(&pt);
+    trace_reader_close(&reader);
+    return status;
+}
 
-    //simulate page requests: lru
-    for (int i = 0; i < data->refstr_len; i++) {
-        page_table_access_page(pt_lru, data->refstr[i]);
-        //page_table_display_contents(pt_lru);
+/**
+ * Restores a snapshot and replays the rest of its trace, either through the
+ * restored table or through forks of it into other policies, and prints the
+ * fault counts at the end of the trace.
+ *
+ * Usage: pra --resume <snapshot> <trace> [policy ...]
+ */
+static int run_resume(int argc, char* argv[]) {
+    if (argc < 4) {
+        printf("Usage: %s --resume <snapshot> <trace> [policy ...]\n", argv[0]);
+        return 1;
+    }
+    struct trace_mark mark;
+    struct page_table* pt = page_table_restore(argv[2], &mark);
+    if (!pt) {
+        return 1;
     }
-    page_table_display(pt_lru);
+    struct trace_reader* reader = trace_reader_open(argv[3]);
+    if (!reader) {
+        page_table_destroy(&pt);
+        return 1;
+    }
+    int status = 1;
+    if (mark.position < 0) {
+        printf("Snapshot %s was not taken mid-trace\n", argv[2]);
+    } else if (trace_reader_header(reader)->page_count != page_table_get_page_count(pt)) {
+        printf("Snapshot %s was not taken on trace %s\n", argv[2], argv[3]);
+    } else if (trace_reader_seek(reader, &mark) == 0) {
+        // without policies the restored table carries on, otherwise every policy forks from it
+        int table_count = argc > 4 ? argc - 4 : 1;
+        struct page_table** tables = (struct page_table**) calloc(table_count, sizeof(struct page_table*));
+        status = 0;
+        for (int i = 0; i < table_count && status == 0; i++) {
+            enum replacement_algorithm policy;
+            struct page_table_config config;
+            if (argc == 4) {
+                tables[i] = pt;
+            } else if (page_table_algorithm_from_name(argv[4 + i], &policy) != 0) {
+                printf("Unknown policy %s\n", argv[4 + i]);
+                status = 1;
+            } else {
+                page_table_config_init(&config, page_table_get_page_count(pt), page_table_get_frame_count(pt), policy);
+                tables[i] = page_table_fork(pt, &config);
+                status = tables[i] ? 0 : 1;
+            }
+        }
+        if (status == 0) {
+            status = simulate_trace(reader, tables, table_count) == 0 ? 0 : 1;
+        }
+        if (status == 0) {
+            printf("resumed %s at reference %lld of %lld\n", argv[2], mark.position, trace_reader_header(reader)->length);
+            for (int i = 0; i < table_count; i++) {
+                printf("%s: %lld faults\n", page_table_algorithm_name(page_table_get_algorithm(tables[i])),
+                       page_table_get_faults(tables[i]));
+            }
+        }
+        for (int i = 0; argc > 4 && i < table_count; i++) {
+            if (tables[i]) {
+                page_table_destroy(&(tables[i]));
+            }
+        }
+        free(tables);
+    }
+    page_table_destroy(&pt);
+    trace_reader_close(&reader);
+    return status;
+}
+
+//output formats of the default mode
+enum output_format {
+    TEXT_OUTPUT = 0,
+    CSV_OUTPUT,
+    JSON_OUTPUT
+};
+
+//what the default mode runs
+struct run_options {
+    char* trace;
+    // the format the trace must have, NULL for any
+    const char* trace_format;
+    enum replacement_algorithm policies[MAX_POLICIES];
+    int policy_count;
+    // 0 for the frame count in the trace header
+    int min_frames;
+    int max_frames;
+    int threads;
+    enum output_format output;
+    // references per report window, 0 for no report
+    long long window;
+    int contents;
+    // pages read ahead on a sequential fault, dirty pages per write-back
+    // batch and bytes per page, for the I/O estimate
+    int readahead;
+    int writeback_batch;
+    int page_size;
+    int io;
+    // fraction of pages sampled for estimated fault counts, 0 for exact ones,
+    // and the number of independent samples
+    double sample_rate;
+    int samples;
+    int verbose;
+};
 
-    //simulate page requests: mfu
-    for (int i = 0; i < data->refstr_len; i++) {
-        page_table_access_page(pt_mfu, data->refstr[i]);
-        //page_table_display_contents(pt_mfu);
+static const struct option long_options[] = {
+        {"trace", required_argument, NULL, 't'},
+        {"trace-format", required_argument, NULL, 'T'},
+        {"policies", required_argument, NULL, 'p'},
+        {"frames", required_argument, NULL, 'f'},
+        {"threads", required_argument, NULL, 'j'},
+        {"output", required_argument, NULL, 'o'},
+        {"window", required_argument, NULL, 'w'},
+        {"contents", no_argument, NULL, 'c'},
+        {"readahead", required_argument, NULL, 'r'},
+        {"writeback-batch", required_argument, NULL, 'b'},
+        {"page-size", required_argument, NULL, 'P'},
+        {"io", no_argument, NULL, 'i'},
+        {"shards", required_argument, NULL, 's'},
+        {"samples", required_argument, NULL, 'n'},
+        {"verbose", no_argument, NULL, 'v'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0}
+};
+
+static void print_usage(const char* program) {
+    printf("Usage: %s [options] <trace>\n"
+           "  -t, --trace <file>             trace to replay, instead of the argument\n"
+           "  -T, --trace-format <name>      fail unless the trace is text, zstd, lz4, packed or delta\n"
+           "  -p, --policies <list>|all      comma separated policies, default FIFO,LRU,MFU\n"
+           "  -f, --frames <n>|<min>-<max>   frame counts, default the trace's\n"
+           "  -j, --threads <n>              sweep the frame counts on n threads, default 1\n"
+           "  -o, --output text|csv|json     result format, default text\n"
+           "  -w, --window <references>      report fault rates every window (text, one frame count)\n"
+           "  -c, --contents                 list every page after the run (text, one frame count)\n"
+           "  -r, --readahead <pages>        read ahead after sequential faults (one frame count)\n"
+           "  -b, --writeback-batch <pages>  write dirty pages back in sorted batches (one frame count)\n"
+           "  -P, --page-size <bytes>        bytes per page in the I/O estimate, default 4096\n"
+           "  -i, --io                       report read and write I/O (one frame count)\n"
+           "  -s, --shards <rate>            estimate faults from a sample of rate of the pages\n"
+           "  -n, --samples <n>              independent samples for --shards, default 5\n"
+           "  -v, --verbose                  announce every page table created\n"
+           "Other modes: --mrc, --ws, --mp, --tlb, --snapshot, --resume\n", program);
+}
+
+/**
+ * Parses a comma separated list of policy names.
+ * @return 0 on success, -1 for an unknown name or too many
+ */
+static int parse_policies(char* list, struct run_options* options) {
+    options->policy_count = 0;
+    if (strcmp(list, "all") == 0) {
+        for (int i = 0; i <= WSCLOCK; i++) {
+            options->policies[options->policy_count++] = (enum replacement_algorithm) i;
+        }
+        return 0;
     }
-    page_table_display(pt_mfu);
+    for (char* name = strtok(list, ","); name; name = strtok(NULL, ",")) {
+        if (options->policy_count == MAX_POLICIES) {
+            printf("At most %d policies\n", MAX_POLICIES);
+            return -1;
+        }
+        if (page_table_algorithm_from_name(name, &(options->policies[options->policy_count])) != 0) {
+            printf("Unknown policy %s\n", name);
+            return -1;
+        }
+        options->policy_count++;
+    }
+    return options->policy_count > 0 ? 0 : -1;
+}
 
-    page_table_display_contents(pt_fifo);
-    page_table_display_contents(pt_lru);
-    page_table_display_contents(pt_mfu);
+/**
+ * Parses a whole number between min and max.
+ * @return 0 on success, -1 for a malformed or out of range number
+ */
+static int parse_count(const char* value, long long min, long long max, long long* count) {
+    char* end;
+    *count = strtoll(value, &end, 10);
+    return end != value && *end == '\0' && *count >= min && *count <= max ? 0 : -1;
+}
+
+/**
+ * Parses a frame count or a range of them.
+ * @return 0 on success, -1 for a malformed or empty range
+ */
+static int parse_frames(const char* value, struct run_options* options) {
+    char* end;
+    long min = strtol(value, &end, 10);
+    long max = min;
+    if (*end == '-') {
+        max = strtol(end + 1, &end, 10);
+    }
+    if (*end != '\0' || min < 1 || max < min || max > INT_MAX) {
+        printf("Invalid frame count %s\n", value);
+        return -1;
+    }
+    options->min_frames = (int) min;
+    options->max_frames = (int) max;
+    return 0;
+}
+
+/**
+ * Parses the options of the default mode over its defaults: FIFO, LRU and MFU
+ * at the trace's frame count on one thread, as text, without verbose output.
+ * @return 0 on success, -1 on a bad option or a missing trace
+ */
+static int parse_options(int argc, char* argv[], struct run_options* options) {
+    char default_policies[] = "FIFO,LRU,MFU";
+    options->trace = NULL;
+    options->trace_format = NULL;
+    parse_policies(default_policies, options);
+    options->min_frames = 0;
+    options->max_frames = 0;
+    options->threads = 1;
+    options->output = TEXT_OUTPUT;
+    options->window = 0;
+    options->contents = 0;
+    options->readahead = 0;
+    options->writeback_batch = 1;
+    options->page_size = 4096;
+    options->io = 0;
+    options->sample_rate = 0;
+    options->samples = 5;
+    options->verbose = 0;
+
+    int option;
+    while ((option = getopt_long(argc, argv, "t:T:p:f:j:o:w:cr:b:P:is:n:vh", long_options, NULL)) != -1) {
+        int status = 0;
+        long long count = 0;
+        char* end;
+        switch (option) {
+            case 't':
+                options->trace = optarg;
+                break;
+            case 'T':
+                options->trace_format = optarg;
+                break;
+            case 'p':
+                status = parse_policies(optarg, options);
+                break;
+            case 'f':
+                status = parse_frames(optarg, options);
+                break;
+            case 'j':
+                status = parse_count(optarg, 1, INT_MAX, &count);
+                options->threads = (int) count;
+                break;
+            case 'o':
+                if (strcmp(optarg, "text") == 0) {
+                    options->output = TEXT_OUTPUT;
+                } else if (strcmp(optarg, "csv") == 0) {
+                    options->output = CSV_OUTPUT;
+                } else if (strcmp(optarg, "json") == 0) {
+                    options->output = JSON_OUTPUT;
+                } else {
+                    status = -1;
+                }
+                break;
+            case 'w':
+                status = parse_count(optarg, 1, LLONG_MAX, &(options->window));
+                break;
+            case 'c':
+                options->contents = 1;
+                break;
+            case 'r':
+                status = parse_count(optarg, 0, INT_MAX, &count);
+                options->readahead = (int) count;
+                break;
+            case 'b':
+                status = parse_count(optarg, 1, INT_MAX, &count);
+                options->writeback_batch = (int) count;
+                break;
+            case 'P':
+                status = parse_count(optarg, 1, INT_MAX, &count);
+                options->page_size = (int) count;
+                break;
+            case 'i':
+                options->io = 1;
+                break;
+            case 's':
+                options->sample_rate = strtod(optarg, &end);
+                status = end != optarg && *end == '\0' && options->sample_rate > 0 && options->sample_rate <= 1 ? 0 : -1;
+                break;
+            case 'n':
+                status = parse_count(optarg, 1, INT_MAX, &count);
+                options->samples = (int) count;
+                break;
+            case 'v':
+                options->verbose = 1;
+                break;
+            default:
+                return -1;
+        }
+        if (status != 0) {
+            printf("Invalid value %s for -%c\n", optarg, option);
+            return -1;
+        }
+    }
+    if (optind < argc && !options->trace) {
+        options->trace = argv[optind++];
+    }
+    if (optind < argc || !options->trace) {
+        return -1;
+    }
+    if ((options->window > 0 || options->contents) &&
+        (options->output != TEXT_OUTPUT || options->min_frames != options->max_frames || options->threads > 1)) {
+        printf("--window and --contents need text output, one frame count and one thread\n");
+        return -1;
+    }
+    //the sweep workers build default tables, so I/O modeling runs one pass
+    if ((options->readahead > 0 || options->writeback_batch > 1 || options->io) &&
+        (options->min_frames != options->max_frames || options->threads > 1)) {
+        printf("--readahead, --writeback-batch and --io need one frame count and one thread\n");
+        return -1;
+    }
+    //a sampled run only estimates fault counts, in one pass
+    if (options->sample_rate > 0 && (options->window > 0 || options->contents || options->readahead > 0 ||
+                                     options->writeback_batch > 1 || options->io || options->threads > 1)) {
+        printf("--shards runs on one thread and estimates fault counts only\n");
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Prints the result of one policy at one frame count as a CSV row or a JSON
+ * object, with its I/O if given and the spread of the estimate of a sampled
+ * run; the caller writes the header or the brackets around them.
+ */
+static void print_result(const struct run_options* options, enum replacement_algorithm policy, int frames,
+                         long long references, long long faults, const struct page_table_io* io,
+                         double faults_stddev, int first) {
+    double rate = references > 0 ? (double) faults / (double) references : 0;
+    const char* name = page_table_algorithm_name(policy);
+    if (options->output == CSV_OUTPUT) {
+        printf("%s,%d,%lld,%lld,%.6f", name, frames, references, faults, rate);
+        if (options->sample_rate > 0) {
+            printf(",%.1f", faults_stddev);
+        }
+        if (io) {
+            printf(",%lld,%lld,%lld,%lld,%lld,%lld,%lld,%lld", io->read_ops, io->pages_read, io->bytes_read,
+                   io->readahead_pages, io->readahead_hits, io->write_ops, io->pages_written, io->bytes_written);
+        }
+        printf("\n");
+    } else {
+        printf("%s  {\"policy\": \"%s\", \"frames\": %d, \"references\": %lld, \"faults\": %lld, "
+               "\"fault_rate\": %.6f", first ? "" : ",\n", name, frames, references, faults, rate);
+        if (options->sample_rate > 0) {
+            printf(", \"faults_stddev\": %.1f", faults_stddev);
+        }
+        if (io) {
+            printf(", \"read_ops\": %lld, \"pages_read\": %lld, \"bytes_read\": %lld, \"readahead_pages\": %lld, "
+                   "\"readahead_hits\": %lld, \"write_ops\": %lld, \"pages_written\": %lld, \"bytes_written\": %lld",
+                   io->read_ops, io->pages_read, io->bytes_read, io->readahead_pages, io->readahead_hits,
+                   io->write_ops, io->pages_written, io->bytes_written);
+        }
+        printf("}");
+    }
+}
+
+/**
+ * Replays a trace through every policy at one frame count in a single pass,
+ * optionally reporting fault rates every window, and prints every table.
+ * @return 0 on success, 1 on error
+ */
+static int run_tables(const struct run_options* options, struct trace_reader* reader) {
+    const struct trace_header* header = trace_reader_header(reader);
+    struct page_table* tables[MAX_POLICIES];
+    int status = 0;
+    for (int i = 0; i < options->policy_count; i++) {
+        struct page_table_config config;
+        page_table_config_init(&config, header->page_count, options->min_frames, options->policies[i]);
+        config.verbose = options->verbose;
+        config.readahead = options->readahead;
+        config.writeback_batch = options->writeback_batch;
+        config.page_size = options->page_size;
+        tables[i] = page_table_create_config(&config);
+        if (!tables[i]) {
+            status = 1;
+        }
+    }
+    if (status == 0 && options->window > 0) {
+        // report the fault rate of every window as the trace runs
+        struct window_report* report = window_report_create(tables, options->policy_count, options->window,
+                                                            REPORT_CAPACITY, stdout);
+        if (!report) {
+            status = 1;
+        } else {
+            int chunk[TRACE_CHUNK_SIZE];
+            unsigned char writes[TRACE_CHUNK_SIZE];
+            int n;
+            while ((n = trace_reader_next_chunk_writes(reader, chunk, writes, TRACE_CHUNK_SIZE)) > 0) {
+                window_report_access_pages(report, chunk, writes, n);
+            }
+            status = n == 0 && window_report_finish(report) == 0 ? 0 : 1;
+            window_report_destroy(&report);
+        }
+    } else if (status == 0) {
+        status = simulate_trace(reader, tables, options->policy_count) == 0 ? 0 : 1;
+    }
+
+    for (int i = 0; i < options->policy_count && status == 0; i++) {
+        if (options->output != TEXT_OUTPUT) {
+            struct page_table_io io;
+            page_table_get_io(tables[i], &io);
+            print_result(options, options->policies[i], options->min_frames, header->length,
+                         page_table_get_faults(tables[i]), options->io ? &io : NULL, 0, i == 0);
+            continue;
+        }
+        page_table_display(tables[i]);
+        if (options->io) {
+            page_table_display_io(tables[i], stdout);
+        }
+        //the full table is a row per page, so only on request
+        if (options->contents) {
+            page_table_display_contents(tables[i], stdout);
+        }
+#ifdef PRA_STATS
+        page_table_display_stats(tables[i], stdout);
+#endif
+    }
+    for (int i = 0; i < options->policy_count; i++) {
+        if (tables[i]) {
+            page_table_destroy(&(tables[i]));
+        }
+    }
+    return status;
+}
+
+/**
+ * Sweeps every policy over the frame counts on a pool of threads and prints
+ * the fault curves.
+ * @return 0 on success, 1 on error
+ */
+static int run_frame_sweep(const struct run_options* options, long long references) {
+    struct sweep_result* result = sweep_run(options->trace, options->policies, options->policy_count,
+                                            options->min_frames, options->max_frames, options->threads);
+    if (!result) {
+        return 1;
+    }
+    if (options->output == TEXT_OUTPUT) {
+        sweep_display(result, stdout);
+    }
+    for (int f = result->min_frames; f <= result->max_frames && options->output != TEXT_OUTPUT; f++) {
+        for (int p = 0; p < result->policy_count; p++) {
+            print_result(options, result->policies[p], f, references,
+                         result->faults[(f - result->min_frames) * result->policy_count + p], NULL, 0,
+                         f == result->min_frames && p == 0);
+        }
+    }
+    sweep_destroy(&result);
+    return 0;
+}
+
+/**
+ * Estimates the fault curves of every policy over the frame counts from
+ * sampled traces, with the spread over the samples as an error bar.
+ * @return 0 on success, 1 on error
+ */
+static int run_sampled_sweep(const struct run_options* options, long long references) {
+    struct shards_result* result = shards_run(options->trace, options->policies, options->policy_count,
+                                              options->min_frames, options->max_frames, options->sample_rate,
+                                              options->samples);
+    if (!result) {
+        return 1;
+    }
+    if (options->output == TEXT_OUTPUT) {
+        shards_display(result, stdout);
+    }
+    for (int f = result->min_frames; f <= result->max_frames && options->output != TEXT_OUTPUT; f++) {
+        for (int p = 0; p < result->policy_count; p++) {
+            int index = (f - result->min_frames) * result->policy_count + p;
+            print_result(options, result->policies[p], f, references, llround(result->mean_faults[index]), NULL,
+                         result->stddev_faults[index], f == result->min_frames && p == 0);
+        }
+    }
+    shards_destroy(&result);
+    return 0;
+}
+
+/**
+ * Replays a trace through a set of policies, at one frame count in a single
+ * pass or over a range of frame counts on a pool of threads, or estimates
+ * them from sampled traces, and prints the fault counts as text, CSV or JSON.
+ *
+ * Usage: pra [-p policies] [-f frames|min-max] [-j threads] [-o text|csv|json] [-w window] [-c]
+ *            [-r readahead] [-b writeback batch] [-P page size] [-i] [-s rate] [-n samples] [-v] <trace>
+ */
+static int run_default(int argc, char* argv[]) {
+    struct run_options options;
+    if (parse_options(argc, argv, &options) != 0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    struct trace_reader* reader = trace_reader_open(options.trace);
+    if (!reader) {
+        return 1;
+    }
+    const char* format = trace_reader_format_name(reader);
+    if (options.trace_format && strcmp(options.trace_format, format) != 0) {
+        printf("Trace %s is %s, not %s\n", options.trace, format, options.trace_format);
+        trace_reader_close(&reader);
+        return 1;
+    }
+    const struct trace_header* header = trace_reader_header(reader);
+    if (options.min_frames == 0) {
+        if (check_trace_frames(header) != 0) {
+            trace_reader_close(&reader);
+            return 1;
+        }
+        options.min_frames = options.max_frames = header->frame_count;
+    }
+    long long references = header->length;
+
+    if (options.output == CSV_OUTPUT) {
+        printf("policy,frames,references,faults,fault_rate%s%s\n", options.sample_rate > 0 ? ",faults_stddev" : "",
+               options.io ? ",read_ops,pages_read,bytes_read,readahead_pages,readahead_hits,write_ops,"
+                            "pages_written,bytes_written" : "");
+    } else if (options.output == JSON_OUTPUT) {
+        printf("[\n");
+    }
+    int status;
+    if (options.sample_rate > 0) {
+        // the sampler reads the trace itself
+        trace_reader_close(&reader);
+        status = run_sampled_sweep(&options, references);
+    } else if (options.min_frames == options.max_frames && options.threads == 1) {
+        status = run_tables(&options, reader);
+        trace_reader_close(&reader);
+    } else {
+        // every sweep worker opens the trace itself
+        trace_reader_close(&reader);
+        status = run_frame_sweep(&options, references);
+    }
+    if (options.output == JSON_OUTPUT) {
+        printf("\n]\n");
+    }
+    return status;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 1 && strcmp(argv[1], "--mrc") == 0) {
+        return run_mrc(argc, argv);
+    }
+    if (argc > 1 && strcmp(argv[1], "--ws") == 0) {
+        return run_working_set(argc, argv);
+    }
+    if (argc > 1 && strcmp(argv[1], "--mp") == 0) {
+        return run_multi_process(argc, argv);
+    }
+    if (argc > 1 && strcmp(argv[1], "--tlb") == 0) {
+        return run_tlb(argc, argv);
+    }
+    if (argc > 1 && strcmp(argv[1], "--snapshot") == 0) {
+        return run_snapshot(argc, argv);
+    }
+    if (argc > 1 && strcmp(argv[1], "--resume") == 0) {
+        return run_resume(argc, argv);
+    }
 
-    page_table_destroy(&pt_fifo);
-    page_table_destroy(&pt_lru);
-    page_table_destroy(&pt_mfu);
-    free(data);
-}
\ No newline at end of file
+    return run_default(argc, argv);
+}
@@ -0,0 +1,81 @@
+/**
+ * Mattson stack-distance analysis. A single pass over a trace yields the LRU
+ * fault count for every frame count at once.
+ *
+ * @author Lee
+ * @version 1.0
+ */
+
+#ifndef STACKDISTANCE_H
+#define STACKDISTANCE_H
+
+#include <stdio.h>
+#include "DataLoader.h"
+
+//forward declarations for structs
+struct stack_distance;
+
+/**
+ * Creates a new stack-distance analyzer.
+ *
+ * @param page_count Number of pages.
+ * @return A stack-distance analyzer.
+ */
+struct stack_distance* stack_distance_create(int page_count);
+
+/**
+ * Destroys a stack-distance analyzer. Sets outside variable to NULL.
+ *
+ * @param sd A stack-distance analyzer.
+ */
+void stack_distance_destroy(struct stack_distance** sd);
+
+/**
+ * Records an access to a page. Costs O(log page_count).
+ *
+ * @param sd A stack-distance analyzer.
+ * @param page The page being accessed.
+ */
+void stack_distance_access_page(struct stack_distance* sd, int page);
+
+/**
+ * Records a batch of accesses.
+ *
+ * @param sd A stack-distance analyzer.
+ * @param pages The pages being accessed.
+ * @param n Number of pages.
+ */
+void stack_distance_access_pages(struct stack_distance* sd, const int* pages, int n);
+
+/**
+ * Streams a trace through the analyzer, starting at the reader's current
+ * position.
+ *
+ * @param reader The trace to replay.
+ * @param sd A stack-distance analyzer.
+ * @return 0 on success, -1 if the trace could not be read.
+ */
+int stack_distance_simulate_trace(struct trace_reader* reader, struct stack_distance* sd);
+
+/**
+ * Returns the number of faults LRU would have taken with the given number of
+ * frames over the accesses recorded so far.
+ *
+ * @param sd A stack-distance analyzer.
+ * @param frame_count Numbers of frames.
+ * @return Number of page faults.
+ */
+long long stack_distance_faults(const struct stack_distance* sd, int frame_count);
+
+/**
+ * Prints the LRU miss-ratio curve: faults and miss ratio for every frame
+ * count in a range.
+ *
+ * @param sd A stack-distance analyzer.
+ * @param min_frames Smallest frame count.
+ * @param max_frames Largest frame count.
+ * @param out The stream to print to.
+ */
+void stack_distance_display(const struct stack_distance* sd, int min_frames, int max_frames, FILE* out);
+
+#endif
@@ -0,0 +1,61 @@
+/**
+ * Stream-VByte coding of zigzag deltas, used by the delta-encoded binary
+ * trace format. Localized references turn into small deltas that take one
+ * byte each; the decoder expands four of them per shuffle and is chosen at
+ * run time like the counter scan kernels.
+ *
+ * An encoded run of n values is ceil(n / 4) control bytes, two bits per value
+ * giving its length in bytes, followed by the little-endian value bytes.
+ *
+ * @author Lee
+ * @version 1.0
+ */
+
+#ifndef STREAMVBYTE_H
+#define STREAMVBYTE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Returns the most bytes stream_vbyte_encode_delta can write for n values.
+ *
+ * @param n Number of values.
+ * @return Size of the largest encoding.
+ */
+static inline size_t stream_vbyte_max_size(size_t n) {
+    return (n + 3) / 4 + 4 * n;
+}
+
+/**
+ * Encodes the differences between consecutive values, the first one relative
+ * to 0. Differences are zigzag coded so small negative steps stay small too.
+ *
+ * @param values The values to encode.
+ * @param n Number of values.
+ * @param out Receives the encoding, at least stream_vbyte_max_size(n) bytes.
+ * @return Number of bytes written.
+ */
+size_t stream_vbyte_encode_delta(const int *values, size_t n, unsigned char *out);
+
+/**
+ * Decodes n values written by stream_vbyte_encode_delta.
+ *
+ * @param in The encoding.
+ * @param in_len Number of bytes available at in; the decoder never reads
+ * past them.
+ * @param n Number of values to decode.
+ * @param out Receives the values.
+ * @return Number of bytes consumed, 0 if the encoding is shorter than n
+ * values need.
+ */
+size_t stream_vbyte_decode_delta(const unsigned char *in, size_t in_len, size_t n, int *out);
+
+/**
+ * Returns the name of the kernel stream_vbyte_decode_delta uses on this CPU.
+ *
+ * @return "ssse3", "neon" or "scalar".
+ */
+const char *stream_vbyte_kernel(void);
+
+#endif
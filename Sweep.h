@@ -0,0 +1,58 @@
+/**
+ * Frame-count sweeps that replay a trace for every (policy, frame_count) pair
+ * and collect the resulting fault curves.
+ *
+ * @author Lee
+ * @version 1.0
+ */
+
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include <stdio.h>
+#include "PageTable.h"
+
+//structs
+struct sweep_result {
+    int min_frames;
+    int max_frames;
+    int policy_count;
+    enum replacement_algorithm *policies;
+    // faults[(frame_count - min_frames) * policy_count + policy]
+    long long *faults;
+};
+
+/**
+ * Runs a sweep over a trace. One page table is built for every pair of policy
+ * and frame count; the tables are sharded across a pool of threads, each of
+ * which streams the trace through its share with its own reader.
+ *
+ * @param filename The trace to replay.
+ * @param policies The policies to sweep.
+ * @param policy_count Number of policies.
+ * @param min_frames Smallest frame count, at least 1.
+ * @param max_frames Largest frame count.
+ * @param thread_count Number of worker threads, at least 1.
+ * @return The fault curves, or NULL if the trace could not be read or a page
+ * table could not be created.
+ */
+struct sweep_result* sweep_run(char* filename, const enum replacement_algorithm* policies, int policy_count,
+                               int min_frames, int max_frames, int thread_count);
+
+/**
+ * Destroys a sweep result. Sets outside variable to NULL.
+ *
+ * @param result A sweep result.
+ */
+void sweep_destroy(struct sweep_result** result);
+
+/**
+ * Prints the fault curves as a table with one row per frame count and one
+ * column per policy.
+ *
+ * @param result A sweep result.
+ * @param out The stream to print to.
+ */
+void sweep_display(const struct sweep_result* result, FILE* out);
+
+#endif
@@ -0,0 +1,138 @@
+/**
+ * Set-associative TLBs in front of a page table. A two-level hierarchy
+ * counts L1 and L2 TLB hits and misses separately from page faults.
+ *
+ * @author Lee
+ * @version 1.0
+ */
+
+#ifndef TLB_H
+#define TLB_H
+
+#include <stdio.h>
+#include "DataLoader.h"
+#include "PageTable.h"
+
+//most ways a TLB set can have; every set is padded to this many entries
+#define TLB_MAX_WAYS 16
+
+//structs
+struct tlb_config {
+    // number of sets, 0 for no TLB at this level
+    int sets;
+    // entries per set, from 1 to TLB_MAX_WAYS
+    int ways;
+    // FIFO, LRU, NFU or CLOCK within a set
+    enum replacement_algorithm policy;
+};
+
+struct tlb_stats {
+    long long hits;
+    long long misses;
+};
+
+//forward declarations for structs
+struct tlb;
+struct tlb_hierarchy;
+
+/**
+ * Creates a TLB.
+ *
+ * @param config The geometry and replacement policy of the TLB.
+ * @return A TLB object, or NULL if the configuration is invalid.
+ */
+struct tlb* tlb_create(const struct tlb_config* config);
+
+/**
+ * Destroys a TLB. Sets outside variable to NULL.
+ *
+ * @param tlb A TLB object.
+ */
+void tlb_destroy(struct tlb** tlb);
+
+/**
+ * Looks up a page, updating the set's replacement state on a hit.
+ *
+ * @param tlb A TLB object.
+ * @param page The page to translate.
+ * @return 1 on a hit, 0 on a miss.
+ */
+int tlb_lookup(struct tlb* tlb, int page);
+
+/**
+ * Installs the translation of a page that missed, replacing an entry of its
+ * set if the set is full.
+ *
+ * @param tlb A TLB object.
+ * @param page The page to install.
+ */
+void tlb_fill(struct tlb* tlb, int page);
+
+/**
+ * Drops the translation of a page, if present.
+ *
+ * @param tlb A TLB object.
+ * @param page The page to drop.
+ */
+void tlb_invalidate(struct tlb* tlb, int page);
+
+/**
+ * Creates an L1 TLB / L2 TLB / page table hierarchy. Pages evicted from the
+ * page table are shot down from both TLBs.
+ *
+ * @param l1 Configuration of the L1 TLB.
+ * @param l2 Configuration of the L2 TLB; sets may be 0 for no L2.
+ * @param pt The page table behind the TLBs. It must not buffer references,
+ *           so OPT is not supported. The hierarchy does not own it.
+ * @return A tlb_hierarchy object, or NULL if a configuration is invalid.
+ */
+struct tlb_hierarchy* tlb_hierarchy_create(const struct tlb_config* l1, const struct tlb_config* l2,
+                                           struct page_table* pt);
+
+/**
+ * Destroys a hierarchy and its TLBs, but not its page table. Sets outside
+ * variable to NULL.
+ *
+ * @param h A tlb_hierarchy object.
+ */
+void tlb_hierarchy_destroy(struct tlb_hierarchy** h);
+
+/**
+ * Simulates instructions accessing pages through the hierarchy. Every access
+ * also reaches the page table, the way hardware sets referenced bits, so its
+ * replacement policy and fault count are the same as without TLBs.
+ *
+ * @param h A tlb_hierarchy object.
+ * @param pages The pages being accessed.
+ * @param n Number of pages.
+ */
+void tlb_hierarchy_access_pages(struct tlb_hierarchy* h, const int* pages, int n);
+
+/**
+ * Replays a trace through the hierarchy, starting at the reader's current
+ * position.
+ *
+ * @param reader The trace to replay.
+ * @param h A tlb_hierarchy object.
+ * @return 0 on success, -1 if the trace could not be read.
+ */
+int tlb_hierarchy_simulate_trace(struct trace_reader* reader, struct tlb_hierarchy* h);
+
+/**
+ * Returns the hit and miss counts of one level.
+ *
+ * @param h A tlb_hierarchy object.
+ * @param level 1 or 2.
+ * @return The counts of that level.
+ */
+struct tlb_stats tlb_hierarchy_stats(const struct tlb_hierarchy* h, int level);
+
+/**
+ * Prints the hits and misses of every TLB level and the page faults.
+ *
+ * @param h A tlb_hierarchy object.
+ * @param out The stream to print to.
+ */
+void tlb_hierarchy_display(const struct tlb_hierarchy* h, FILE* out);
+
+#endif
@@ -0,0 +1,20 @@
+/**
+ * Program to convert a text trace into the memory-mapped binary trace format.
+ *
+ * @author Lee
+ * @version 1.0
+ */
+#include <stdio.h>
+#include <string.h>
+#include "DataLoader.h"
+
+int main(int argc, char* argv[]) {
+    enum trace_encoding encoding = PACKED_ENCODING;
+    if (argc == 4 && strcmp(argv[3], "delta") == 0) {
+        encoding = DELTA_ENCODING;
+    } else if (argc != 3 && !(argc == 4 && strcmp(argv[3], "packed") == 0)) {
+        printf("Usage: %s <text trace> <binary trace> [packed|delta]\n", argv[0]);
+        return 1;
+    }
+    return trace_convert_to_binary(argv[1], argv[2], encoding) == 0 ? 0 : 1;
+}
@@ -0,0 +1,76 @@
+/**
+ * Online fault-rate reporting. Every window of references closes with one
+ * sample per page table, kept in a preallocated ring and written out in
+ * batches, so long traces can be watched while they run without a printf
+ * per line on the hot path.
+ *
+ * @author Lee
+ * @version 1.0
+ */
+
+#ifndef WINDOW_REPORT_H
+#define WINDOW_REPORT_H
+
+#include <stdio.h>
+#include "PageTable.h"
+
+//structs
+struct window_sample {
+    // references at the end of the window
+    long long time;
+    // references and faults within the window
+    long long references;
+    long long faults;
+    // frames in use at the end of the window
+    int resident;
+};
+
+//forward declarations for structs
+struct window_report;
+
+/**
+ * Creates a report over several page tables. The tables stay owned by the
+ * caller and must outlive the report.
+ *
+ * @param tables The page tables to watch.
+ * @param table_count Number of page tables.
+ * @param window References per window, at least 1.
+ * @param capacity Windows held before a batch is written, at least 1.
+ * @param out The stream batches are written to.
+ * @return A report object, or NULL for a bad window or capacity.
+ */
+struct window_report* window_report_create(struct page_table** tables, int table_count, long long window,
+                                           int capacity, FILE* out);
+
+/**
+ * Destroys a report without writing what it still holds. Sets outside
+ * variable to NULL.
+ *
+ * @param report A report object.
+ */
+void window_report_destroy(struct window_report** report);
+
+/**
+ * Replays references through every page table, closing a window each time
+ * one fills. OPT decides references late, so its windows lag behind by the
+ * references it holds back.
+ *
+ * @param report A report object.
+ * @param pages The references to replay.
+ * @param writes 1 for every write and 0 for every read, or NULL if all are reads.
+ * @param n Number of references.
+ * @return 0 on success, -1 if a batch could not be written.
+ */
+int window_report_access_pages(struct window_report* report, const int* pages, const unsigned char* writes,
+                               int n);
+
+/**
+ * Flushes the page tables, closes the last window and writes every
+ * window not yet written.
+ *
+ * @param report A report object.
+ * @return 0 on success, -1 if a batch could not be written.
+ */
+int window_report_finish(struct window_report* report);
+
+#endif
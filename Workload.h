@@ -0,0 +1,96 @@
+/**
+ * Synthetic reference strings for benchmarks and experiments. Every
+ * generator is deterministic for a given seed.
+ *
+ * @author Lee
+ * @version 1.0
+ */
+
+#ifndef WORKLOAD_H
+#define WORKLOAD_H
+
+#include <stdint.h>
+
+//enumeration of the reference patterns
+enum workload_kind {
+    // every page equally likely
+    UNIFORM_WORKLOAD = 0,
+    // page popularity follows a Zipf law with exponent zipf_theta
+    ZIPF_WORKLOAD,
+    // one pass after another over all pages in order
+    SCAN_WORKLOAD,
+    // a cycle over loop_pages pages, slightly larger than memory in the classic LRU worst case
+    LOOP_WORKLOAD,
+    // Zipf references within a set of phase_pages pages that moves every phase_length references
+    PHASE_WORKLOAD,
+    // every multiple of stride equally likely, the aligned pages that defeat a weak hash
+    STRIDE_WORKLOAD,
+    WORKLOAD_KIND_COUNT
+};
+
+//options for generating a workload
+struct workload_config {
+    enum workload_kind kind;
+    int page_count;
+    long long length;
+    // exponent of the Zipf law, for ZIPF_WORKLOAD and PHASE_WORKLOAD
+    double zipf_theta;
+    // pages in the LOOP_WORKLOAD cycle
+    int loop_pages;
+    // working set size and duration of a PHASE_WORKLOAD phase
+    int phase_pages;
+    long long phase_length;
+    // distance between the pages of STRIDE_WORKLOAD
+    int stride;
+    uint64_t seed;
+};
+
+/**
+ * Fills in a workload configuration with defaults: a Zipf exponent of 0.99,
+ * a loop over an eighth of the pages, phases of a sixteenth of the pages
+ * lasting a tenth of the trace and a stride of 64 pages.
+ *
+ * @param config The configuration to fill in.
+ * @param kind The reference pattern.
+ * @param page_count Number of pages.
+ * @param length Number of references.
+ */
+void workload_config_init(struct workload_config* config, enum workload_kind kind, int page_count, long long length);
+
+/**
+ * Generates a reference string.
+ *
+ * @param config The workload to generate.
+ * @return config->length page numbers below page_count, to be freed by the
+ * caller, or NULL for a bad configuration.
+ */
+int* workload_generate(const struct workload_config* config);
+
+/**
+ * Writes a generated reference string as a text trace that pra can replay.
+ *
+ * @param config The workload to generate.
+ * @param frame_count The frame count recorded in the trace header.
+ * @param filename The file to write.
+ * @return 0 on success, -1 on error.
+ */
+int workload_write_trace(const struct workload_config* config, int frame_count, char* filename);
+
+/**
+ * Returns the name of a reference pattern.
+ *
+ * @param kind A reference pattern.
+ * @return The name of the pattern, e.g. "zipf".
+ */
+const char* workload_name(enum workload_kind kind);
+
+/**
+ * Looks up a reference pattern by name.
+ *
+ * @param name The name of the pattern.
+ * @param kind Receives the pattern.
+ * @return 0 on success, -1 for an unknown name.
+ */
+int workload_from_name(const char* name, enum workload_kind* kind);
+
+#endif